@@ -10,7 +10,7 @@ using BGAPI2;
 
 namespace Kinovea.Camera.Baumer
 {
-    public class FrameGrabber : ICaptureSource
+    public class FrameGrabber : ICaptureSource, IDirectFrameProducer
     {
         public event EventHandler GrabbingStatusChanged;
         public event EventHandler<FrameProducedEventArgs> FrameProduced;
@@ -50,6 +50,7 @@ namespace Kinovea.Camera.Baumer
         private const double megabyte = 1024 * 1024;
         private int frameBufferSize = 0;
         private byte[] frameBuffer;
+        private volatile IFrameSink frameSink;
         private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
 
         #endregion
@@ -216,6 +217,11 @@ namespace Kinovea.Camera.Baumer
                 LogError(e, "");
             }
         }
+
+        public void SetFrameSink(IFrameSink sink)
+        {
+            frameSink = sink;
+        }
         #endregion
 
         #region Private methods
@@ -304,7 +310,29 @@ namespace Kinovea.Camera.Baumer
                 payloadLength = (int)(image.Width * image.Height * bpp);
             }
 
-            CopyFrame(image, payloadLength);
+            // Copy straight into the pipeline when the frame is passed through as is.
+            IFrameSink sink = frameSink;
+            bool direct = imageFormat == ImageFormat.JPEG || !finishline.Enabled;
+            if (sink != null && direct && sink.FrameLength >= payloadLength)
+            {
+                ComputeDataRate(payloadLength);
+
+                Frame entry = sink.ClaimSlot();
+                if (entry != null)
+                {
+                    CopyFrame(image, entry.Buffer, payloadLength);
+                    sink.CommitSlot(entry, payloadLength);
+                }
+
+                image.Release();
+
+                if (entry != null && FrameProduced != null)
+                    FrameProduced(this, new FrameProducedEventArgs(entry.Buffer, payloadLength, true));
+
+                return;
+            }
+
+            CopyFrame(image, frameBuffer, payloadLength);
             image.Release();
 
             if (imageFormat != ImageFormat.JPEG && finishline.Enabled)
@@ -367,10 +395,10 @@ namespace Kinovea.Camera.Baumer
         /// <summary>
         /// Takes a converted input buffer and copy it into the output buffer.
         /// </summary>
-        private unsafe void CopyFrame(BGAPI2.Image image, int length)
+        private unsafe void CopyFrame(BGAPI2.Image image, byte[] output, int length)
         {
             // At this point the image is either in Mono8, Bayer**8 or BGR8.
-            fixed (byte* p = frameBuffer)
+            fixed (byte* p = output)
             {
                 IntPtr ptrDst = (IntPtr)p;
                 NativeMethods.memcpy(ptrDst.ToPointer(), image.Buffer.ToPointer(), length);
@@ -14,7 +14,7 @@ namespace Kinovea.Camera.Daheng
     /// <summary>
     /// Main grabbing class for Daheng Imaging devices.
     /// </summary>
-    public class FrameGrabber : ICaptureSource
+    public class FrameGrabber : ICaptureSource, IDirectFrameProducer
     {
         public event EventHandler<FrameProducedEventArgs> FrameProduced;
         public event EventHandler GrabbingStatusChanged;
@@ -50,6 +50,7 @@ namespace Kinovea.Camera.Daheng
         private const double megabyte = 1024 * 1024;
         private int incomingBufferSize = 0;
         private byte[] incomingBuffer;
+        private volatile IFrameSink frameSink;
 
         private IGXDevice device;
         private IGXFeatureControl featureControl;
@@ -208,6 +209,11 @@ namespace Kinovea.Camera.Daheng
                 log.Error(e.Message);
             }
         }
+
+        public void SetFrameSink(IFrameSink sink)
+        {
+            frameSink = sink;
+        }
         #endregion
 
         private void Open()
@@ -329,30 +335,48 @@ namespace Kinovea.Camera.Daheng
 
         }
 
-        private unsafe void FillRGB24(IntPtr buffer)
+        private void FillRGB24(IntPtr buffer)
         {
-            fixed (byte* p = incomingBuffer)
-            {
-                IntPtr ptrDst = (IntPtr)p;
-                NativeMethods.memcpy(ptrDst.ToPointer(), buffer.ToPointer(), width * 3 * height);
-            }
-
-            ComputeDataRate(incomingBufferSize);
+            Fill(buffer, width * 3 * height);
+        }
 
-            if (FrameProduced != null)
-                FrameProduced(this, new FrameProducedEventArgs(incomingBuffer, incomingBufferSize));
+        private void FillY800(IntPtr buffer)
+        {
+            Fill(buffer, width * height);
         }
 
-        private unsafe void FillY800(IntPtr buffer)
+        private unsafe void Fill(IntPtr buffer, int length)
         {
+            ComputeDataRate(incomingBufferSize);
+
+            // Copy straight into the pipeline when it is attached, otherwise go through the incoming buffer.
+            IFrameSink sink = frameSink;
+            if (sink != null && sink.FrameLength >= incomingBufferSize)
+            {
+                Frame entry = sink.ClaimSlot();
+                if (entry == null)
+                    return;
+
+                fixed (byte* p = entry.Buffer)
+                {
+                    IntPtr ptrDst = (IntPtr)p;
+                    NativeMethods.memcpy(ptrDst.ToPointer(), buffer.ToPointer(), length);
+                }
+
+                sink.CommitSlot(entry, incomingBufferSize);
+
+                if (FrameProduced != null)
+                    FrameProduced(this, new FrameProducedEventArgs(entry.Buffer, incomingBufferSize, true));
+
+                return;
+            }
+
             fixed (byte* p = incomingBuffer)
             {
                 IntPtr ptrDst = (IntPtr)p;
-                NativeMethods.memcpy(ptrDst.ToPointer(), buffer.ToPointer(), width * height);
+                NativeMethods.memcpy(ptrDst.ToPointer(), buffer.ToPointer(), length);
             }
 
-            ComputeDataRate(incomingBufferSize);
-
             if (FrameProduced != null)
                 FrameProduced(this, new FrameProducedEventArgs(incomingBuffer, incomingBufferSize));
         }
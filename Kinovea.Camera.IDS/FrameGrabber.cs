@@ -32,7 +32,7 @@ namespace Kinovea.Camera.IDS
     /// <summary>
     /// The main grabbing class for IDS uEye devices.
     /// </summary>
-    public class FrameGrabber : ICaptureSource
+    public class FrameGrabber : ICaptureSource, IDirectFrameProducer
     {
         public event EventHandler<FrameProducedEventArgs> FrameProduced;
         public event EventHandler GrabbingStatusChanged;
@@ -68,6 +68,7 @@ namespace Kinovea.Camera.IDS
         private const double megabyte = 1024 * 1024;
         private int incomingBufferSize = 0;
         private byte[] incomingBuffer;
+        private volatile IFrameSink frameSink;
         private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
 
         #endregion
@@ -198,6 +199,11 @@ namespace Kinovea.Camera.IDS
                 log.Error(e);
             }
         }
+
+        public void SetFrameSink(IFrameSink sink)
+        {
+            frameSink = sink;
+        }
         #endregion
 
         #region Private methods
@@ -306,6 +312,31 @@ namespace Kinovea.Camera.IDS
             System.IntPtr ptrSrc;
             camera.Memory.ToIntPtr(memId, out ptrSrc);
 
+            // Copy straight into the pipeline when the frame is passed through as is.
+            IFrameSink sink = frameSink;
+            if (sink != null && !finishline.Enabled && sink.FrameLength >= incomingBufferSize)
+            {
+                ComputeDataRate(incomingBufferSize);
+
+                Frame entry = sink.ClaimSlot();
+                if (entry != null)
+                {
+                    fixed (byte* p = entry.Buffer)
+                    {
+                        IntPtr ptrDst = (IntPtr)p;
+                        camera.Memory.CopyImageMem(ptrSrc, memId, ptrDst);
+                    }
+
+                    sink.CommitSlot(entry, incomingBufferSize);
+
+                    if (FrameProduced != null)
+                        FrameProduced(this, new FrameProducedEventArgs(entry.Buffer, incomingBufferSize, true));
+                }
+
+                camera.Memory.Unlock(memId);
+                return;
+            }
+
             fixed (byte* p = incomingBuffer)
             {
                 IntPtr ptrDst = (IntPtr)p;
@@ -4,6 +4,7 @@ using System.Linq;
 using System.Text;
 using System.Threading;
 using Kinovea.Pipeline.MemoryLayout;
+using Kinovea.Pipeline.WaitStrategies;
 using Kinovea.Services;
 
 namespace Kinovea.Pipeline.Consumers
@@ -29,9 +30,37 @@ namespace Kinovea.Pipeline.Consumers
             get { return consumerPosition.Data; }
         }
 
+        public IWaitStrategy WaitStrategy
+        {
+            get { return waitStrategy; }
+        }
+
+        /// <summary>
+        /// Counter receiving the lag of each entry. Consumers posting their own durations override this with their counter.
+        /// </summary>
         public virtual BenchmarkCounterBandwidth BenchmarkCounter
         {
-            get { return null; }
+            get { return lagCounter; }
+        }
+
+        /// <summary>
+        /// Number of entries processed between two publications of the consumer position.
+        /// Publishing within a batch lets the producer reuse the slots we are done with while we catch up.
+        /// </summary>
+        public int PublishInterval
+        {
+            get { return publishInterval; }
+            set { publishInterval = Math.Max(1, value); }
+        }
+
+        /// <summary>
+        /// Maximum number of entries processed before going back to the wait strategy and checking for deactivation.
+        /// Zero means no limit.
+        /// </summary>
+        public int MaxBatchSize
+        {
+            get { return maxBatchSize; }
+            set { maxBatchSize = Math.Max(0, value); }
         }
         
         // Synchronization
@@ -41,11 +70,29 @@ namespace Kinovea.Pipeline.Consumers
         private CacheLineStorageBool active = new CacheLineStorageBool(false);
         private CacheLineStorageBool deactivateAsked = new CacheLineStorageBool(false);
         private CacheLineStorageLong consumerPosition = new CacheLineStorageLong(-1); 
+        private IWaitStrategy waitStrategy;
+        private int publishInterval = 1;
+        private int maxBatchSize = 0;
+        private BenchmarkCounterBandwidth lagCounter = new BenchmarkCounterBandwidth();
+        private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
         
         // Frame memory storage
         private RingBuffer buffer;
         protected int frameLength;
 
+        /// <summary>
+        /// By default the consumer thread sleeps while waiting for frames.
+        /// </summary>
+        protected AbstractConsumer()
+            : this(new BlockingWaitStrategy())
+        {
+        }
+
+        protected AbstractConsumer(IWaitStrategy waitStrategy)
+        {
+            this.waitStrategy = waitStrategy;
+        }
+
         public void Run()
         {
             started.Data = true;
@@ -92,6 +139,7 @@ namespace Kinovea.Pipeline.Consumers
         public void Deactivate()
         {
             deactivateAsked.Data = true;
+            waitStrategy.Interrupt();
         }
 
         public void Stop()
@@ -103,7 +151,7 @@ namespace Kinovea.Pipeline.Consumers
             
             // stopAsked is checked after activation and after deactivation.
             if (active.Data)
-                deactivateAsked.Data = true;
+                Deactivate();
             else
                 activateEventHandle.Set();
         }
@@ -122,20 +170,51 @@ namespace Kinovea.Pipeline.Consumers
             while(!deactivateAsked.Data)
             {
                 // Wait until at least the next frame is available, but if more than one is available consume everything in batch.
-                long readable = buffer.WaitFor(next);
+                long readable = buffer.WaitFor(next, waitStrategy);
+
+                int batchSize = maxBatchSize;
+                if (batchSize > 0)
+                    readable = Math.Min(readable, next + batchSize - 1);
+
+                int interval = publishInterval;
+                int unpublished = 0;
+                BenchmarkCounterBandwidth counter = BenchmarkCounter;
 
                 while (next <= readable)
                 {
+                    if (counter != null)
+                        counter.PostLag(buffer.ProducerPosition - next);
+
                     Frame entry = buffer.GetEntry(next);
                     ProcessEntry(next, entry);
                     next++;
+
+                    // Update our current position so the producer knows not to wrap.
+                    if (++unpublished >= interval)
+                    {
+                        consumerPosition.Data = next - 1;
+                        unpublished = 0;
+                    }
                 }
 
-                // Update our current position so the producer knows not to wrap.
                 consumerPosition.Data = next - 1;
             }
 
             active.Data = false;
+
+            LogMetrics();
+        }
+
+        private void LogMetrics()
+        {
+            // Report the lag since the consumer was created, to tune the publication interval and batch size.
+            BenchmarkCounterBandwidth counter = BenchmarkCounter;
+            Dictionary<string, float> metrics = counter == null ? null : counter.GetMetrics();
+            if (metrics == null || metrics.Count == 0)
+                return;
+
+            string values = string.Join(", ", metrics.Select(pair => string.Format("{0}: {1:0.##}", pair.Key, pair.Value)));
+            log.DebugFormat("{0} deactivated. Publish interval: {1}, max batch size: {2}. {3}.", GetType().Name, publishInterval, maxBatchSize, values);
         }
 
         protected virtual void BeforeActivate()
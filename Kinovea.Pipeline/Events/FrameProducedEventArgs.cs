@@ -29,10 +29,22 @@ namespace Kinovea.Pipeline
     {
         public readonly byte[] Buffer;
         public readonly int PayloadLength;
+
+        /// <summary>
+        /// The frame was written directly into a ring buffer slot and is already committed.
+        /// </summary>
+        public readonly bool Committed;
+
         public FrameProducedEventArgs(byte[] buffer, int payloadLength)
+            : this(buffer, payloadLength, false)
+        {
+        }
+
+        public FrameProducedEventArgs(byte[] buffer, int payloadLength, bool committed)
         {
             this.Buffer = buffer;
             this.PayloadLength = payloadLength;
+            this.Committed = committed;
         }
     }
 }
\ No newline at end of file
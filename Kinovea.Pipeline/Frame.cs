@@ -14,6 +14,11 @@ namespace Kinovea.Pipeline
         public byte[] Buffer { get; private set; }
         public int PayloadLength { get; set; }
 
+        /// <summary>
+        /// Time at which the frame entered the pipeline, in microseconds.
+        /// </summary>
+        public long Timestamp { get; set; }
+
         public Frame(int bufferSize)
         {
             this.Buffer = new byte[bufferSize];
@@ -27,6 +32,7 @@ namespace Kinovea.Pipeline
         {
             System.Buffer.BlockCopy(source.Buffer, 0, this.Buffer, 0, source.PayloadLength);
             this.PayloadLength = source.PayloadLength;
+            this.Timestamp = source.Timestamp;
         }
     }
 }
@@ -4,7 +4,9 @@ using System.Linq;
 using System.Text;
 using Kinovea.Services;
 using System.Threading;
+using System.Diagnostics;
 using Kinovea.Pipeline.MemoryLayout;
+using Kinovea.Pipeline.Consumers;
 
 namespace Kinovea.Pipeline
 {
@@ -15,7 +17,7 @@ namespace Kinovea.Pipeline
     ///
     /// Inspired by the disruptor pattern.
     /// </summary>
-    public class FramePipeline
+    public class FramePipeline : IFrameSink
     {
         public int FrameLength
         {
@@ -55,6 +57,8 @@ namespace Kinovea.Pipeline
         //private BenchmarkCounterIntervals heartbeat = new BenchmarkCounterIntervals();
         //private BenchmarkCounterIntervals commitbeat = new BenchmarkCounterIntervals();
         private FrequencyCounter frequencyCounter = new FrequencyCounter(24, 48, true);
+        private Stopwatch stopwatch = Stopwatch.StartNew();
+        private double microsecondsPerTick = 1000000.0 / Stopwatch.Frequency;
 
         // Note: we lock drops on write as it's written from UI thread and producer thread.
         // The freshness of the value is not paramount so we do not lock on read to avoid slowing down the producer thread.
@@ -118,11 +122,20 @@ namespace Kinovea.Pipeline
 
             producer.FrameProduced += producer_FrameProduced;
 
+            // Producers that can write into the slots themselves skip the intermediate copy.
+            IDirectFrameProducer directProducer = producer as IDirectFrameProducer;
+            if (directProducer != null)
+                directProducer.SetFrameSink(this);
+
             log.DebugFormat("Pipeline connected to producer and consumers.");
         }
 
         private void Unbind()
         {
+            IDirectFrameProducer directProducer = producer as IDirectFrameProducer;
+            if (directProducer != null)
+                directProducer.SetFrameSink(null);
+
             producer.FrameProduced -= producer_FrameProduced;
             ringBuffer.ClearConsumers();
 
@@ -143,7 +156,11 @@ namespace Kinovea.Pipeline
             //if (benchmarkMode == BenchmarkMode.Heartbeat)
               //return;
 
+            if (e.Committed)
+                return;
+
             frequencyCounter.Tick();
+            long timestamp = (long)(stopwatch.ElapsedTicks * microsecondsPerTick);
 
             // Claim the next slot in the ring buffer.
             Frame entry;
@@ -162,11 +179,11 @@ namespace Kinovea.Pipeline
             }
             else
             {
-                WriteSlot(e.Buffer, e.PayloadLength, entry);
+                WriteSlot(e.Buffer, e.PayloadLength, timestamp, entry);
             }
         }
 
-        private void WriteSlot(byte[] bytes, int payloadLength, Frame entry)
+        private void WriteSlot(byte[] bytes, int payloadLength, long timestamp, Frame entry)
         {
             //-------------------------
             // Runs in producer thread.
@@ -177,6 +194,7 @@ namespace Kinovea.Pipeline
             {
                 Buffer.BlockCopy(bytes, 0, entry.Buffer, 0, payloadLength);
                 entry.PayloadLength = payloadLength;
+                entry.Timestamp = timestamp;
             }
             else
             {
@@ -187,6 +205,40 @@ namespace Kinovea.Pipeline
             //commitbeat.Tick();
         }
 
+        #region IFrameSink
+        public Frame ClaimSlot()
+        {
+            //-------------------------
+            // Runs in producer thread.
+            //-------------------------
+
+            frequencyCounter.Tick();
+            long timestamp = (long)(stopwatch.ElapsedTicks * microsecondsPerTick);
+
+            Frame entry;
+            if (!ringBuffer.TryClaim(out entry))
+            {
+                lock (lockerDrops)
+                    drops++;
+
+                return null;
+            }
+
+            entry.Timestamp = timestamp;
+            return entry;
+        }
+
+        public void CommitSlot(Frame entry, int payloadLength)
+        {
+            //-------------------------
+            // Runs in producer thread.
+            //-------------------------
+
+            entry.PayloadLength = Math.Min(payloadLength, entry.Buffer.Length);
+            ringBuffer.Commit();
+        }
+        #endregion
+
         #region Benchmarking support
         public void SetBenchmarkMode(BenchmarkMode benchmarkMode)
         {
@@ -194,17 +246,22 @@ namespace Kinovea.Pipeline
             //ringBuffer.SetBenchmarkMode(benchmarkMode);
         }
 
+        /// <summary>
+        /// Collect the counters of the consumers, including their lag histograms.
+        /// </summary>
         public Dictionary<string, IBenchmarkCounter> StopBenchmark()
         {
-            return null;
-            /*foreach (BenchmarkCounterIntervals counter in counters.Values)
-                counter.Stop();
-
             Dictionary<string, IBenchmarkCounter> result = new Dictionary<string, IBenchmarkCounter>();
-            foreach (var pair in counters)
-                result.Add(pair.Key, pair.Value as IBenchmarkCounter);
+            for (int i = 0; i < consumers.Count; i++)
+            {
+                AbstractConsumer consumer = consumers[i] as AbstractConsumer;
+                if (consumer == null || consumer.BenchmarkCounter == null)
+                    continue;
+
+                result.Add(string.Format("{0} ({1})", consumer.GetType().Name, i), consumer.BenchmarkCounter);
+            }
 
-            return result;*/
+            return result;
         }
         private void InitializeBenchmarkCounters()
         {
@@ -0,0 +1,20 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+
+namespace Kinovea.Pipeline
+{
+    /// <summary>
+    /// Producer that can write incoming frames straight into the ring buffer instead of handing a buffer to the pipeline for copy.
+    /// The producer must still raise FrameProduced for every committed frame, with the Committed flag set.
+    /// </summary>
+    public interface IDirectFrameProducer : IFrameProducer
+    {
+        /// <summary>
+        /// Attach or detach (null) the pipeline.
+        /// Called from the UI thread while the grabbing thread may be running.
+        /// </summary>
+        void SetFrameSink(IFrameSink sink);
+    }
+}
@@ -11,6 +11,11 @@ namespace Kinovea.Pipeline
         bool Active { get; }
         long ConsumerPosition { get; }
 
+        /// <summary>
+        /// How the consumer thread waits for new frames. Null for consumers that never wait on the ring buffer.
+        /// </summary>
+        IWaitStrategy WaitStrategy { get; }
+
         void Run();
         void SetRingBuffer(RingBuffer buffer);
         void ClearRingBuffer();
@@ -0,0 +1,30 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+
+namespace Kinovea.Pipeline
+{
+    /// <summary>
+    /// Write end of the pipeline, for producers able to fill the ring buffer slots directly.
+    /// Both methods must be called from the grabbing thread, one claim followed by one commit.
+    /// </summary>
+    public interface IFrameSink
+    {
+        /// <summary>
+        /// Size of the slots in bytes.
+        /// </summary>
+        int FrameLength { get; }
+
+        /// <summary>
+        /// Claim the next slot of the ring buffer.
+        /// Returns null if a consumer is still reading the slot, the frame is then counted as dropped and must not be committed.
+        /// </summary>
+        Frame ClaimSlot();
+
+        /// <summary>
+        /// Publish the claimed slot to the consumers once the frame bytes have been written into it.
+        /// </summary>
+        void CommitSlot(Frame entry, int payloadLength);
+    }
+}
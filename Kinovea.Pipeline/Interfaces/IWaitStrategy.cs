@@ -0,0 +1,30 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+
+namespace Kinovea.Pipeline
+{
+    /// <summary>
+    /// How a consumer thread waits for the producer to publish new frames.
+    /// Each consumer owns its strategy, the ring buffer notifies all of them after each commit.
+    /// </summary>
+    public interface IWaitStrategy
+    {
+        /// <summary>
+        /// Wait until the producer has published the position and return the last published position.
+        /// May return a lower position if the wait was interrupted.
+        /// </summary>
+        long WaitFor(long position, RingBuffer buffer);
+
+        /// <summary>
+        /// Called from the producer thread after a commit. Must be cheap when nobody is waiting.
+        /// </summary>
+        void Notify();
+
+        /// <summary>
+        /// Release the consumer from its current or next wait, so it can check for deactivation.
+        /// </summary>
+        void Interrupt();
+    }
+}
@@ -36,7 +36,8 @@ namespace Kinovea.Pipeline
         private int capacity;
         private int remainderMask;
         private Random random = new Random();
-        private List<IFrameConsumer> consumers;
+        private IFrameConsumer[] gatingConsumers = new IFrameConsumer[0]; // Consumers the producer must not overtake.
+        private IWaitStrategy[] waitStrategies = new IWaitStrategy[0]; // Strategies to notify after each commit.
         private CacheLineStorageLong producerPosition = new CacheLineStorageLong(-1); // Last position written to by the producer.
         private BenchmarkMode benchmarkMode;
         private bool allocated;
@@ -70,12 +71,15 @@ namespace Kinovea.Pipeline
 
         public void SetConsumers(List<IFrameConsumer> consumers)
         {
-            this.consumers = consumers;
+            // Flatten the lists once here so the producer and consumer paths don't allocate.
+            waitStrategies = consumers.Where(c => c.WaitStrategy != null).Select(c => c.WaitStrategy).ToArray();
+            gatingConsumers = consumers.ToArray();
         }
 
         public void ClearConsumers()
         {
-            this.consumers.Clear();
+            gatingConsumers = new IFrameConsumer[0];
+            waitStrategies = new IWaitStrategy[0];
         }
 
         public void Teardown()
@@ -142,8 +146,12 @@ namespace Kinovea.Pipeline
             //-------------------------
 
             // The producer has finished stuffing the bytes in the Frame.
-            // Mark the position as available for reading.
+            // Mark the position as available for reading and wake up sleeping consumers.
             producerPosition.Data = producerPosition.Data + 1;
+
+            IWaitStrategy[] strategies = waitStrategies;
+            for (int i = 0; i < strategies.Length; i++)
+                strategies[i].Notify();
         }
 
         private void WaitForReaders(long position)
@@ -162,11 +170,11 @@ namespace Kinovea.Pipeline
                 return;
             }
 
-            // Compute wrap point : position - bufferSize.
-            // Get minimum position from readers.
-
-            // Yield thread until all readers are past the wrap point.
-            //while (wrapPoint > (minPosition = GetMinimumPosition()))
+            // Spin then sleep until all active readers are past the wrap point.
+            long mustHaveRead = position - slots.Length;
+            SpinWait spinner = new SpinWait();
+            while (!IsReadPast(mustHaveRead))
+                spinner.SpinOnce();
         }
 
         private bool IsWriteable(long position)
@@ -183,31 +191,39 @@ namespace Kinovea.Pipeline
                 return !drop;
             }
 
+            return IsReadPast(position - slots.Length);
+        }
+
+        private bool IsReadPast(long mustHaveRead)
+        {
             // Test whether all active readers have read past the wrap point.
-            long mustHaveRead = position - slots.Length;
-            return consumers.All(c => !c.Active || c.ConsumerPosition >= mustHaveRead);
+            IFrameConsumer[] consumers = gatingConsumers;
+            for (int i = 0; i < consumers.Length; i++)
+            {
+                if (consumers[i].Active && consumers[i].ConsumerPosition < mustHaveRead)
+                    return false;
+            }
+
+            return true;
         }
         #endregion
 
         #region Consumer barrier
-        public long WaitFor(long position)
+        public long WaitFor(long position, IWaitStrategy waitStrategy)
         {
             //---------------------------
             // Runs in a consumer thread.
             //---------------------------
 
-            // In the case of a fast consumer, this method will Yield the consumer thread until the asked position is written.
+            // In the case of a fast consumer, this method will wait according to the consumer strategy until the asked position is written.
             // In the case of a slow consumer, this method will return instantly with the current producer position,
             // this way the consumer can consume all the frames up to the current position on its own, in a tight loop.
-            // Thread context switch via Sleep() is not critical here, because it can only happen when the consumer is 
-            // faster than the producer anyway, so it should have time to catch-up later on.
-            while (position > producerPosition.Data)
-            {
-                //Thread.Yield(); // Only in .NET 4.0
-                Thread.Sleep(0);
-            }
-            
-            return producerPosition.Data;
+            // The returned position may be lower than asked if the wait was interrupted for deactivation.
+            long available = producerPosition.Data;
+            if (available >= position)
+                return available;
+
+            return waitStrategy.WaitFor(position, this);
         }
 
         #endregion
@@ -0,0 +1,61 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading;
+
+namespace Kinovea.Pipeline.WaitStrategies
+{
+    /// <summary>
+    /// Spin briefly to catch frames that are about to be committed, then block on an event until the producer signals.
+    /// Idle consumers do not use any CPU. The producer only pays for the event when the consumer is actually asleep.
+    /// </summary>
+    public class BlockingWaitStrategy : IWaitStrategy
+    {
+        private AutoResetEvent signal = new AutoResetEvent(false);
+        private int sleeping;
+        private volatile bool interrupted;
+
+        public long WaitFor(long position, RingBuffer buffer)
+        {
+            SpinWait spinner = new SpinWait();
+            long available;
+            while ((available = buffer.ProducerPosition) < position)
+            {
+                if (interrupted)
+                {
+                    interrupted = false;
+                    break;
+                }
+
+                if (!spinner.NextSpinWillYield)
+                {
+                    spinner.SpinOnce();
+                    continue;
+                }
+
+                // Announce the sleep before checking the position again, this way either we see the commit
+                // or the producer sees the flag and sets the event. A stale signal only causes an extra loop.
+                Interlocked.Exchange(ref sleeping, 1);
+                if (buffer.ProducerPosition < position && !interrupted)
+                    signal.WaitOne();
+
+                Interlocked.Exchange(ref sleeping, 0);
+            }
+
+            return available;
+        }
+
+        public void Notify()
+        {
+            if (Interlocked.CompareExchange(ref sleeping, 0, 1) == 1)
+                signal.Set();
+        }
+
+        public void Interrupt()
+        {
+            interrupted = true;
+            signal.Set();
+        }
+    }
+}
@@ -0,0 +1,43 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading;
+
+namespace Kinovea.Pipeline.WaitStrategies
+{
+    /// <summary>
+    /// Spin without ever giving up the core.
+    /// Lowest latency but burns a full core even when the camera is idle, only for benchmarks or dedicated machines.
+    /// </summary>
+    public class BusySpinWaitStrategy : IWaitStrategy
+    {
+        private volatile bool interrupted;
+
+        public long WaitFor(long position, RingBuffer buffer)
+        {
+            long available;
+            while ((available = buffer.ProducerPosition) < position)
+            {
+                if (interrupted)
+                {
+                    interrupted = false;
+                    break;
+                }
+
+                Thread.SpinWait(1);
+            }
+
+            return available;
+        }
+
+        public void Notify()
+        {
+        }
+
+        public void Interrupt()
+        {
+            interrupted = true;
+        }
+    }
+}
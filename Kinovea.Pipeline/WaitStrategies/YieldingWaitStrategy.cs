@@ -0,0 +1,48 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading;
+
+namespace Kinovea.Pipeline.WaitStrategies
+{
+    /// <summary>
+    /// Spin for a short while then yield the time slice to other threads at each iteration.
+    /// Low latency, the thread stays runnable and still shows up as CPU usage while waiting.
+    /// </summary>
+    public class YieldingWaitStrategy : IWaitStrategy
+    {
+        private const int spinTries = 100;
+        private volatile bool interrupted;
+
+        public long WaitFor(long position, RingBuffer buffer)
+        {
+            int counter = spinTries;
+            long available;
+            while ((available = buffer.ProducerPosition) < position)
+            {
+                if (interrupted)
+                {
+                    interrupted = false;
+                    break;
+                }
+
+                if (counter > 0)
+                    counter--;
+                else
+                    Thread.Yield();
+            }
+
+            return available;
+        }
+
+        public void Notify()
+        {
+        }
+
+        public void Interrupt()
+        {
+            interrupted = true;
+        }
+    }
+}
@@ -1069,6 +1069,11 @@ namespace Kinovea.ScreenManager
             }
 
             float load = (ellapsed / (1000.0f / (float)pipelineManager.Frequency)) * 100;
+
+            // With parallel encoding the consumer only copies the frame, the backlog of the encoders is the actual load.
+            int capacity = pipelineManager.WriterInFlightCapacity;
+            if (capacity > 0)
+                load = Math.Max(load, ((float)pipelineManager.WriterInFlight / capacity) * 100);
              
             string signal = string.Format(" {0:0.00} fps", pipelineManager.Frequency);
             string bandwidth = string.Format(" {0:0.00} MB/s", cameraGrabber.LiveDataRate);
@@ -1184,7 +1189,8 @@ namespace Kinovea.ScreenManager
 
             // Get the displayed frame.
             int target = 0;
-            Bitmap displayFrame = delayedDisplay ? delayer.GetWeak(delay, ImageRotation, Mirrored, out target) : delayer.GetWeak(0, ImageRotation, Mirrored, out target);
+            int age = delayedDisplay ? delay : 0;
+            Bitmap displayFrame = delayer.GetWeak(age, ImageRotation, Mirrored, viewportController.DisplayRectangle.Size, out target);
             
             if (displayFrame == null && target < 0)
                 displayFrame = CreateWaitImage(-target);
@@ -1814,6 +1820,7 @@ namespace Kinovea.ScreenManager
             log.DebugFormat("Manual scheduled recording: saving delay buffer content.");
 
             MJPEGWriter writer = new MJPEGWriter();
+            writer.EncoderThreads = PreferencesManager.CapturePreferences.RecordingEncoderThreads;
             VideoInfo info = new VideoInfo();
             info.OriginalSize = new Size(imageDescriptor.Width, imageDescriptor.Height);
 
@@ -1919,7 +1926,7 @@ namespace Kinovea.ScreenManager
 
                 bool copied = delayer.GetStrong(age, delayedFrame);
                 if (copied)
-                    writer.SaveFrame(imageDescriptor.Format, delayedFrame.Buffer, delayedFrame.PayloadLength, imageDescriptor.TopDown);
+                    writer.SaveFrame(imageDescriptor.Format, delayedFrame.Buffer, delayedFrame.PayloadLength, imageDescriptor.TopDown, delayedFrame.Timestamp);
             }
 
             writer.CloseSavingContext(true);
@@ -2034,7 +2041,7 @@ namespace Kinovea.ScreenManager
             // Force a refresh if we are not connected to the camera to enable "pause and browse".
             if (cameraLoaded && !cameraConnected)
             {
-                Bitmap delayed = delayer.GetWeak(delay, ImageRotation, Mirrored, out _);
+                Bitmap delayed = delayer.GetWeak(delay, ImageRotation, Mirrored, viewportController.DisplayRectangle.Size, out _);
                 viewportController.Bitmap = delayed;
                 viewportController.Refresh();
             }
@@ -24,6 +24,22 @@ namespace Kinovea.ScreenManager
 
         public long Ellapsed { get; private set; }
 
+        /// <summary>
+        /// Number of frames handed to the writer and not yet written to the file.
+        /// </summary>
+        public int WriterInFlight
+        {
+            get { return writer == null ? 0 : writer.InFlight; }
+        }
+
+        /// <summary>
+        /// Number of frames the writer can absorb before blocking this consumer. 0 if the writer encodes synchronously.
+        /// </summary>
+        public int WriterInFlightCapacity
+        {
+            get { return writer == null ? 0 : writer.InFlightCapacity; }
+        }
+
         private bool allocated;
         private Delayer delayer;
         private int age;
@@ -95,6 +111,7 @@ namespace Kinovea.ScreenManager
                 writer.Dispose();
 
             writer = new MJPEGWriter();
+            writer.EncoderThreads = PreferencesManager.CapturePreferences.RecordingEncoderThreads;
 
             VideoInfo info = new VideoInfo();
             info.OriginalSize = new Size(delayerImageDescriptor.Width, delayerImageDescriptor.Height);
@@ -159,7 +176,7 @@ namespace Kinovea.ScreenManager
                 // Compositers (e.g: quadrants with different ages) are only supported in display.
                 bool copied = delayer.GetStrong(age, delayedFrame);
                 if (copied)
-                    writer.SaveFrame(delayerImageDescriptor.Format, delayedFrame.Buffer, delayedFrame.PayloadLength, delayerImageDescriptor.TopDown);
+                    writer.SaveFrame(delayerImageDescriptor.Format, delayedFrame.Buffer, delayedFrame.PayloadLength, delayerImageDescriptor.TopDown, delayedFrame.Timestamp);
             }
 
             Ellapsed = stopwatch.ElapsedMilliseconds - then;
@@ -37,6 +37,12 @@ namespace Kinovea.ScreenManager
             }
         }
 
+        public IWaitStrategy WaitStrategy
+        {
+            // Runs on the UI thread on frame events, never waits on the ring buffer.
+            get { return null; }
+        }
+
         public Frame Frame
         {
             get { return frame; }
@@ -6,6 +6,7 @@ using Kinovea.Video;
 using Kinovea.Video.FFMpeg;
 using Kinovea.Pipeline;
 using Kinovea.Pipeline.Consumers;
+using Kinovea.Pipeline.WaitStrategies;
 using Kinovea.Services;
 
 namespace Kinovea.ScreenManager
@@ -25,6 +26,22 @@ namespace Kinovea.ScreenManager
 
         public long Ellapsed { get; private set; }
 
+        /// <summary>
+        /// Number of frames handed to the writer and not yet written to the file.
+        /// </summary>
+        public int WriterInFlight
+        {
+            get { return writer == null ? 0 : writer.InFlight; }
+        }
+
+        /// <summary>
+        /// Number of frames the writer can absorb before blocking this consumer. 0 if the writer encodes synchronously.
+        /// </summary>
+        public int WriterInFlightCapacity
+        {
+            get { return writer == null ? 0 : writer.InFlightCapacity; }
+        }
+
         private ImageDescriptor imageDescriptor;
         private MJPEGWriter writer;
         private bool recording;
@@ -34,7 +51,9 @@ namespace Kinovea.ScreenManager
         private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
 
         public ConsumerRealtime(string shortId)
+            : base(new YieldingWaitStrategy())
         {
+            // Only active while recording, favor latency over CPU usage.
             this.shortId = shortId;
             stopwatch.Start();
         }
@@ -59,6 +78,7 @@ namespace Kinovea.ScreenManager
                 writer.Dispose();
 
             writer = new MJPEGWriter();
+            writer.EncoderThreads = PreferencesManager.CapturePreferences.RecordingEncoderThreads;
             
             VideoInfo info = new VideoInfo();
             info.OriginalSize = new Size(imageDescriptor.Width, imageDescriptor.Height);
@@ -97,7 +117,7 @@ namespace Kinovea.ScreenManager
 
             long then = stopwatch.ElapsedMilliseconds;
 
-            writer.SaveFrame(imageDescriptor.Format, entry.Buffer, entry.PayloadLength, imageDescriptor.TopDown);
+            writer.SaveFrame(imageDescriptor.Format, entry.Buffer, entry.PayloadLength, imageDescriptor.TopDown, entry.Timestamp);
 
             Ellapsed = stopwatch.ElapsedMilliseconds - then;
         }
@@ -9,6 +9,7 @@ using System.Drawing.Imaging;
 using System.Diagnostics;
 using System.Threading;
 using Kinovea.Services;
+using Kinovea.Video.FFMpeg;
 
 namespace Kinovea.ScreenManager
 {
@@ -35,7 +36,6 @@ namespace Kinovea.ScreenManager
 
         #region Members
         private List<Frame> frames = new List<Frame>();
-        private Rectangle rect;
         private int minCapacity = 12;
         private int reserveCapacity = 8;    // Number of frames kept unreachable to clients.
         private int fullCapacity = 12;      // Total number of frames kept.
@@ -43,8 +43,6 @@ namespace Kinovea.ScreenManager
         private bool allocated;
         private long availableMemory;
         private ImageDescriptor imageDescriptor;
-        int pitch;
-        byte[] tempJpeg;
         private Stopwatch stopwatch = new Stopwatch();
         private object lockerFrame = new object();
         private object lockerPosition = new object();
@@ -112,11 +110,6 @@ namespace Kinovea.ScreenManager
 
             if (frames.Count > 0)
             {
-                // The following variables are used during frame -> bitmap conversion.
-                this.rect = new Rectangle(0, 0, imageDescriptor.Width, imageDescriptor.Height);
-                this.pitch = imageDescriptor.Width * 3;
-                this.tempJpeg = new byte[bufferSize];
-
                 this.allocated = true;
                 this.fullCapacity = frames.Count;
                 this.availableMemory = availableMemory;
@@ -201,6 +194,16 @@ namespace Kinovea.ScreenManager
         /// to implement a waiting image.
         /// </summary>
         public Bitmap GetWeak(int age, ImageRotation rotation, bool mirror, out int target)
+        {
+            return GetWeak(age, rotation, mirror, Size.Empty, out target);
+        }
+
+        /// <summary>
+        /// Get the frame from `age` frames ago for display.
+        /// JPEG frames are decoded at a reduced size when the display size is smaller than the image, 
+        /// the returned bitmap may be smaller than the image and must be stretched to the display rectangle.
+        /// </summary>
+        public Bitmap GetWeak(int age, ImageRotation rotation, bool mirror, Size displaySize, out int target)
         {
             //----------------------------------------------------
             // Runs in the UI thread, to get the image to display.
@@ -219,50 +222,41 @@ namespace Kinovea.ScreenManager
                     if (frame == null)
                         return null;
 
+                    Size size = new Size(imageDescriptor.Width, imageDescriptor.Height);
+                    if (imageDescriptor.Format == Kinovea.Services.ImageFormat.JPEG && displaySize.Width > 0 && displaySize.Height > 0)
+                    {
+                        // The display size is expressed after rotation.
+                        bool sideways = rotation == ImageRotation.Rotate90 || rotation == ImageRotation.Rotate270;
+                        Size targetSize = sideways ? new Size(displaySize.Height, displaySize.Width) : displaySize;
+                        size = BitmapHelper.GetJPEGScaledSize(size, targetSize);
+                    }
+
                     // Returns a newly allocated RGB24 bitmap.
                     // TODO: maybe get a pre-allocated bitmap from caller.
-                    copy = new Bitmap(imageDescriptor.Width, imageDescriptor.Height, PixelFormat.Format24bppRgb);
+                    copy = new Bitmap(size.Width, size.Height, PixelFormat.Format24bppRgb);
 
-                    switch (imageDescriptor.Format)
+                    // Uncompressed formats go through the native kernels, JPEG through the turbojpeg decoder.
+                    if (imageDescriptor.Format == Kinovea.Services.ImageFormat.JPEG)
                     {
-                        case Kinovea.Services.ImageFormat.RGB24:
-                            BitmapHelper.FillFromRGB24(copy, rect, imageDescriptor.TopDown, frame.Buffer);
-                            break;
-                        case Kinovea.Services.ImageFormat.RGB32:
-                            BitmapHelper.FillFromRGB32(copy, rect, imageDescriptor.TopDown, frame.Buffer);
-                            break;
-                        case Kinovea.Services.ImageFormat.Y800:
-                            BitmapHelper.FillFromY800(copy, rect, imageDescriptor.TopDown, frame.Buffer);
-                            break;
-                        case Kinovea.Services.ImageFormat.JPEG:
-                            BitmapHelper.FillFromJPEG(copy, rect, tempJpeg, frame.Buffer, frame.PayloadLength, pitch);
-                            break;
+                        if (!BitmapHelper.FillFromJPEG(copy, frame.Buffer, frame.PayloadLength))
+                        {
+                            log.Error("Could not decode JPEG frame for display.");
+                            copy.Dispose();
+                            return null;
+                        }
+                    }
+                    else if (!PixelConverter.Fill(copy, frame.Buffer, imageDescriptor.Format, imageDescriptor.TopDown))
+                    {
+                        log.ErrorFormat("Could not convert {0} frame for display.", imageDescriptor.Format);
+                        copy.Dispose();
+                        return null;
                     }
 
-                    switch (rotation)
+                    if (rotation != ImageRotation.Rotate0 || mirror)
                     {
-                        case ImageRotation.Rotate90:
-                            if (mirror)
-                                copy.RotateFlip(RotateFlipType.Rotate90FlipX);
-                            else
-                                copy.RotateFlip(RotateFlipType.Rotate90FlipNone);
-                            break;
-                        case ImageRotation.Rotate180:
-                            if (mirror)
-                                copy.RotateFlip(RotateFlipType.Rotate180FlipX);
-                            else
-                                copy.RotateFlip(RotateFlipType.Rotate180FlipNone);
-                            break;
-                        case ImageRotation.Rotate270:
-                            if (mirror)
-                                copy.RotateFlip(RotateFlipType.Rotate270FlipX);
-                            else
-                                copy.RotateFlip(RotateFlipType.Rotate270FlipNone);
-                            break;
-                        default:
-                            if (mirror)
-                                copy.RotateFlip(RotateFlipType.RotateNoneFlipX);
-                            break;
+                        Bitmap transformed = PixelConverter.Transform(copy, rotation, mirror);
+                        copy.Dispose();
+                        copy = transformed;
                     }
                 }
                 catch
@@ -347,7 +341,6 @@ namespace Kinovea.ScreenManager
         {
             allocated = false;
             fullCapacity = 0;
-            rect = Rectangle.Empty;
             imageDescriptor = ImageDescriptor.Invalid;
             availableMemory = 0;
             currentPosition = -1;
@@ -22,6 +22,36 @@ namespace Kinovea.ScreenManager
             get { return pipeline == null ? 0 : pipeline.Drops; }
         }
 
+        /// <summary>
+        /// Frames accepted by the recorder but still being compressed.
+        /// With parallel encoding these are not held in the ring buffer anymore.
+        /// </summary>
+        public int WriterInFlight
+        {
+            get 
+            {
+                if (consumerRealtime != null)
+                    return consumerRealtime.WriterInFlight;
+                else if (consumerDelayer != null)
+                    return consumerDelayer.WriterInFlight;
+                else
+                    return 0;
+            }
+        }
+
+        public int WriterInFlightCapacity
+        {
+            get 
+            {
+                if (consumerRealtime != null)
+                    return consumerRealtime.WriterInFlightCapacity;
+                else if (consumerDelayer != null)
+                    return consumerDelayer.WriterInFlightCapacity;
+                else
+                    return 0;
+            }
+        }
+
         public double Frequency
         {
             get { return pipeline == null ? 0 : pipeline.Frequency; }
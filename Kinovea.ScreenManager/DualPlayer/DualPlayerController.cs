@@ -228,6 +228,16 @@ namespace Kinovea.ScreenManager
 
             PlayerScreen otherPlayer = GetOtherPlayer(player);
 
+            if (dualSaveInProgress)
+            {
+                // The side by side export moves the players from its decoding threads, possibly both at once.
+                // Leave the sync state and the UI alone and only forward the image for merging.
+                if (view.Merging && e.Value != null)
+                    otherPlayer.SetSyncMergeImage(e.Value, false);
+
+                return;
+            }
+
             if (dynamicSynching)
             {
                 if (player.IsPlaying)
@@ -275,7 +285,7 @@ namespace Kinovea.ScreenManager
             if (!view.Merging || e.Value == null)
                 return;
 
-            otherPlayer.SetSyncMergeImage(e.Value, !dualSaveInProgress);
+            otherPlayer.SetSyncMergeImage(e.Value, true);
         }
         #endregion
 
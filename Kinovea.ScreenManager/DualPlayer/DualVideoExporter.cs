@@ -1,7 +1,10 @@
 ﻿using System;
+using System.Collections.Concurrent;
 using System.Collections.Generic;
+using System.Diagnostics;
 using System.Linq;
 using System.Text;
+using System.Threading;
 using System.Windows.Forms;
 using Kinovea.ScreenManager.Languages;
 using System.IO;
@@ -30,6 +33,16 @@ namespace Kinovea.ScreenManager
         private VideoFileWriter videoFileWriter = new VideoFileWriter();
         private BackgroundWorker bgWorkerDualSave;
         private formProgressBar dualSaveProgressBar;
+
+        // Each player is decoded and rendered on its own thread, ahead of the composition.
+        private List<long> times;
+        private CancellationTokenSource cancellation;
+        private BlockingCollection<Bitmap> leftQueue;
+        private BlockingCollection<Bitmap> rightQueue;
+        private Bitmap composite;
+        private Point leftLocation;
+        private Point rightLocation;
+        private const int queueCapacity = 2;
         private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
 
         public void Export(CommonTimeline commonTimeline, PlayerScreen leftPlayer, PlayerScreen rightPlayer, bool merging)
@@ -98,98 +111,199 @@ namespace Kinovea.ScreenManager
             // This is executed in Worker Thread space. (Do not call any UI methods)
             log.Debug("Saving side by side video.");
 
+            Stopwatch stopwatch = Stopwatch.StartNew();
             int threadResult = 0;
-            
-            // Get first frame outside the loop to set up the saving context.
-            long currentTime = 0;
-            Bitmap composite = GetCompositeImage(currentTime);
-            
-            log.DebugFormat("Composite size: {0}.", composite.Size);
 
-            VideoInfo info = new VideoInfo
+            times = new List<long>();
+            long time = 0;
+            times.Add(time);
+            while (time < commonTimeline.LastTime)
             {
-                ReferenceSize = composite.Size
-            };
-
-            string formatString = FilenameHelper.GetFormatString(dualSaveFileName);
+                time += commonTimeline.FrameTime;
+                times.Add(time);
+            }
 
-            SaveResult result = videoFileWriter.OpenSavingContext(dualSaveFileName, info, formatString, fileFrameInterval);
+            cancellation = new CancellationTokenSource();
+            leftQueue = new BlockingCollection<Bitmap>(queueCapacity);
+            rightQueue = new BlockingCollection<Bitmap>(queueCapacity);
 
-            if (result != SaveResult.Success)
+            // When merging, the right image is painted on the left one, so both players must be moved and rendered in sequence.
+            List<Thread> threads = new List<Thread>();
+            if (merging)
             {
-                e.Result = 2;
-                return;
+                threads.Add(StartDecoding("left", () => DecodingWorker(leftPlayer, rightPlayer, leftQueue)));
+                rightQueue.CompleteAdding();
             }
-
-            videoFileWriter.SaveFrame(composite);
-            composite.Dispose();
-            
-            while (currentTime < commonTimeline.LastTime && !dualSaveCancelled)
+            else
             {
-                currentTime += commonTimeline.FrameTime;
+                threads.Add(StartDecoding("left", () => DecodingWorker(leftPlayer, null, leftQueue)));
+                threads.Add(StartDecoding("right", () => DecodingWorker(rightPlayer, null, rightQueue)));
+            }
 
-                if (bgWorkerDualSave.CancellationPending)
+            int frames = 0;
+            try
+            {
+                foreach (long currentTime in times)
                 {
-                    threadResult = 1;
-                    dualSaveCancelled = true;
-                    break;
+                    if (bgWorkerDualSave.CancellationPending || dualSaveCancelled)
+                    {
+                        threadResult = 1;
+                        dualSaveCancelled = true;
+                        break;
+                    }
+
+                    Bitmap left;
+                    Bitmap right = null;
+                    if (!leftQueue.TryTake(out left, Timeout.Infinite, cancellation.Token))
+                        break;
+
+                    if (!merging && !rightQueue.TryTake(out right, Timeout.Infinite, cancellation.Token))
+                    {
+                        left.Dispose();
+                        break;
+                    }
+
+                    // Set up the saving context on the first frame, once we know the composite size.
+                    bool composed = composite != null || OpenSavingContext(left, right);
+                    if (composed)
+                    {
+                        BitmapHelper.CopyToLocation(left, composite, leftLocation);
+                        if (right != null)
+                            BitmapHelper.CopyToLocation(right, composite, rightLocation);
+                    }
+
+                    left.Dispose();
+                    if (right != null)
+                        right.Dispose();
+
+                    if (!composed)
+                    {
+                        threadResult = 2;
+                        break;
+                    }
+
+                    videoFileWriter.SaveFrame(composite);
+                    frames++;
+
+                    int percent = (int)((double)currentTime * 100 / commonTimeline.LastTime);
+                    bgWorkerDualSave.ReportProgress(percent);
                 }
+            }
+            catch (OperationCanceledException)
+            {
+            }
+            finally
+            {
+                cancellation.Cancel();
+                foreach (Thread thread in threads)
+                    thread.Join();
 
-                composite = GetCompositeImage(currentTime);
-                videoFileWriter.SaveFrame(composite);
-                composite.Dispose();
+                DisposeQueue(leftQueue);
+                DisposeQueue(rightQueue);
 
-                int percent = (int)((double)currentTime * 100 / commonTimeline.LastTime);
-                bgWorkerDualSave.ReportProgress(percent);
+                if (composite != null)
+                {
+                    composite.Dispose();
+                    composite = null;
+                }
             }
 
-            if (!dualSaveCancelled)
-                threadResult = 0;
-            
+            log.DebugFormat("Side by side video: {0} frames in {1} ms ({2:0.0} fps).", frames, stopwatch.ElapsedMilliseconds, frames / Math.Max(stopwatch.Elapsed.TotalSeconds, 0.001));
+
             e.Result = threadResult;
         }
-        
-        private void GotoTime(PlayerScreen player, long commonTime)
+
+        private Thread StartDecoding(string name, ThreadStart worker)
         {
-            long localTime = commonTimeline.GetLocalTime(player, commonTime);
-            localTime = Math.Max(0, localTime);
-            player.GotoTime(localTime, false);
+            Thread thread = new Thread(worker) { IsBackground = true, Name = "Dual export decoding " + name };
+            thread.Start();
+            return thread;
         }
 
-        private Bitmap GetCompositeImage(long currentTime)
+        /// <summary>
+        /// Move the player through the common timeline and push its rendered images to the queue.
+        /// </summary>
+        private void DecodingWorker(PlayerScreen player, PlayerScreen follower, BlockingCollection<Bitmap> queue)
         {
-            Bitmap composite;
-
-            GotoTime(leftPlayer, currentTime);
-            GotoTime(rightPlayer, currentTime);
-
-            Bitmap img1 = leftPlayer.GetFlushedImage();
-
-            if (!merging)
+            try
             {
-                Bitmap img2 = rightPlayer.GetFlushedImage();
-                composite = ImageHelper.GetSideBySideComposite(img1, img2, true, true);
-                img2.Dispose();
+                foreach (long currentTime in times)
+                {
+                    GotoTime(player, currentTime);
+                    if (follower != null)
+                        GotoTime(follower, currentTime);
+
+                    Bitmap image = player.GetFlushedImage();
+                    try
+                    {
+                        queue.Add(image, cancellation.Token);
+                    }
+                    catch (OperationCanceledException)
+                    {
+                        image.Dispose();
+                        throw;
+                    }
+                }
             }
-            else
+            catch (OperationCanceledException)
             {
-                int height = img1.Height;
-                int width = img1.Width;
+            }
+            catch (Exception e)
+            {
+                log.Error("Error while decoding frames for the side by side video.", e);
+            }
+            finally
+            {
+                queue.CompleteAdding();
+            }
+        }
 
-                if (img1.Height % 2 != 0)
-                    height++;
+        /// <summary>
+        /// Allocate the composite image reused for every frame and open the saving context at its size.
+        /// The layout matches ImageHelper.GetSideBySideComposite: even height, width multiple of 4, shortest image vertically centered.
+        /// </summary>
+        private bool OpenSavingContext(Bitmap left, Bitmap right)
+        {
+            int width = right == null ? left.Width : left.Width + right.Width;
+            int height = right == null ? left.Height : Math.Max(left.Height, right.Height);
 
-                if (width % 4 != 0)
-                    width += 4 - (width % 4);
+            if (height % 2 != 0)
+                height++;
 
-                composite = new Bitmap(width, height, img1.PixelFormat);
-                Graphics g = Graphics.FromImage(composite);
-                g.DrawImage(img1, Point.Empty);
-            }
+            if (width % 4 != 0)
+                width += 4 - (width % 4);
 
-            img1.Dispose();
-            
-            return composite;
+            leftLocation = new Point(0, right == null ? 0 : (height - left.Height) / 2);
+            if (right != null)
+                rightLocation = new Point(left.Width, (height - right.Height) / 2);
+
+            composite = new Bitmap(width, height, left.PixelFormat);
+            log.DebugFormat("Composite size: {0}.", composite.Size);
+
+            VideoInfo info = new VideoInfo
+            {
+                ReferenceSize = composite.Size
+            };
+
+            string formatString = FilenameHelper.GetFormatString(dualSaveFileName);
+
+            videoFileWriter.EncodingProfile = PreferencesManager.PlayerPreferences.VideoEncodingProfile;
+            SaveResult result = videoFileWriter.OpenSavingContext(dualSaveFileName, info, formatString, fileFrameInterval);
+            return result == SaveResult.Success;
+        }
+
+        private void DisposeQueue(BlockingCollection<Bitmap> queue)
+        {
+            Bitmap image;
+            while (queue.TryTake(out image))
+                image.Dispose();
+        }
+        
+        private void GotoTime(PlayerScreen player, long commonTime)
+        {
+            long localTime = commonTimeline.GetLocalTime(player, commonTime);
+            localTime = Math.Max(0, localTime);
+            player.GotoTime(localTime, false);
         }
 
         private void bgWorkerDualSave_ProgressChanged(object sender, ProgressChangedEventArgs e)
@@ -42,7 +42,8 @@ namespace Kinovea.ScreenManager
             this.metadata = metadata;
             metadata.BeforeKVAImport();
 
-            string extension = Path.GetExtension(source).ToLower();
+            // When not a file the source is the KVA content itself.
+            string extension = isFile ? Path.GetExtension(source).ToLower() : ".kva";
             if (extension == ".kva" || extension == ".xml")
             {
                 ImportKVA(source, isFile);
@@ -0,0 +1,220 @@
+﻿#region License
+/*
+Copyright © Joan Charmant 2009.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+*/
+#endregion
+using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Drawing;
+using System.Drawing.Imaging;
+using System.Threading;
+using Kinovea.Services;
+using Kinovea.Video;
+
+namespace Kinovea.ScreenManager
+{
+    /// <summary>
+    /// Produces the images of a video export with decoding and rendering running on their own threads, ahead of the consumer.
+    /// 
+    /// decoding thread -> [decoded queue] -> rendering thread -> [rendered queue] -> Enumerate() caller.
+    /// 
+    /// Each stage is a single thread and the queues are FIFO, so the frame order is preserved.
+    /// The queues are bounded and the bitmaps come from fixed-size pools, so a fast stage blocks until the next one catches up.
+    /// A bitmap returned by the enumerator is valid until the next item is requested, like the serial enumerator it replaces.
+    /// </summary>
+    public class ExportPipeline
+    {
+        private class RenderedFrame
+        {
+            public Bitmap Image;
+            public int Duplication;
+        }
+
+        private VideoReader reader;
+        private SavingSettings settings;
+        private CancellationTokenSource cancellation = new CancellationTokenSource();
+        private BlockingCollection<VideoFrame> decodedQueue = new BlockingCollection<VideoFrame>(queueCapacity);
+        private BlockingCollection<RenderedFrame> renderedQueue = new BlockingCollection<RenderedFrame>(queueCapacity);
+        private BlockingCollection<Bitmap> decodedPool = new BlockingCollection<Bitmap>();
+        private BlockingCollection<Bitmap> renderedPool = new BlockingCollection<Bitmap>();
+        private List<Bitmap> bitmaps = new List<Bitmap>();
+        private int decodedAllocated;
+        private int renderedAllocated;
+        private Exception stageException;
+        
+        // Each pool holds enough bitmaps for a full queue plus the one being worked on at each end.
+        private const int queueCapacity = 3;
+        private const int poolSize = queueCapacity + 2;
+        private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
+
+        public ExportPipeline(VideoReader reader, SavingSettings settings)
+        {
+            this.reader = reader;
+            this.settings = settings;
+        }
+
+        /// <summary>
+        /// Lazily enumerate the images that will end up in the final file.
+        /// Return fully painted bitmaps ready for saving in the output.
+        /// Disposing the enumerator (early cancellation or error) stops the stages and releases the bitmaps.
+        /// </summary>
+        public IEnumerable<Bitmap> Enumerate()
+        {
+            Thread decodingThread = new Thread(DecodingWorker) { IsBackground = true, Name = "Export decoding" };
+            Thread renderingThread = new Thread(RenderingWorker) { IsBackground = true, Name = "Export rendering" };
+            decodingThread.Start();
+            renderingThread.Start();
+
+            try
+            {
+                foreach (RenderedFrame frame in renderedQueue.GetConsumingEnumerable())
+                {
+                    for (int i = 0; i < frame.Duplication; i++)
+                        yield return frame.Image;
+
+                    renderedPool.Add(frame.Image);
+                }
+            }
+            finally
+            {
+                cancellation.Cancel();
+                decodingThread.Join();
+                renderingThread.Join();
+
+                foreach (Bitmap bitmap in bitmaps)
+                    bitmap.Dispose();
+            }
+
+            if (stageException != null)
+                throw new InvalidOperationException("Error in the export pipeline.", stageException);
+        }
+
+        private void DecodingWorker()
+        {
+            try
+            {
+                // Enumerates the raw frames from the video (at original video size).
+                // The reader reuses its frame buffer so each frame is copied out before moving on.
+                foreach (VideoFrame vf in reader.FrameEnumerator())
+                {
+                    if (vf == null)
+                    {
+                        log.Error("Working zone enumerator yield null.");
+                        break;
+                    }
+
+                    Bitmap copy = TakeBitmap(decodedPool, ref decodedAllocated, vf.Image.Size, vf.Image.PixelFormat, vf.Image);
+                    BitmapHelper.Copy(vf.Image, copy, new Rectangle(Point.Empty, copy.Size));
+                    decodedQueue.Add(new VideoFrame(vf.Timestamp, copy), cancellation.Token);
+                }
+            }
+            catch (OperationCanceledException)
+            {
+            }
+            catch (Exception e)
+            {
+                log.Error("Error while decoding frames for export.", e);
+                stageException = e;
+            }
+            finally
+            {
+                decodedQueue.CompleteAdding();
+            }
+        }
+
+        private void RenderingWorker()
+        {
+            try
+            {
+                foreach (VideoFrame vf in decodedQueue.GetConsumingEnumerable(cancellation.Token))
+                {
+                    // Indexed images cannot be painted on, render them in RGB.
+                    PixelFormat format = IsIndexed(vf.Image.PixelFormat) ? PixelFormat.Format24bppRgb : vf.Image.PixelFormat;
+                    Bitmap output = TakeBitmap(renderedPool, ref renderedAllocated, vf.Image.Size, format, null);
+                    
+                    bool onKeyframe = false;
+                    if (settings.FlushDrawings)
+                    {
+                        onKeyframe = settings.ImageRetriever(vf, output);
+                    }
+                    else
+                    {
+                        // The analysis is muxed in the file instead of painted on the images.
+                        using (Graphics canvas = Graphics.FromImage(output))
+                            canvas.DrawImageUnscaled(vf.Image, 0, 0);
+                    }
+
+                    decodedPool.Add(vf.Image);
+                    
+                    bool savable = onKeyframe || !settings.KeyframesOnly;
+                    if (!savable)
+                    {
+                        renderedPool.Add(output);
+                        continue;
+                    }
+
+                    RenderedFrame frame = new RenderedFrame();
+                    frame.Image = output;
+                    frame.Duplication = settings.PausedVideo && onKeyframe ? settings.KeyframeDuplication : settings.Duplication;
+                    renderedQueue.Add(frame, cancellation.Token);
+                }
+            }
+            catch (OperationCanceledException)
+            {
+            }
+            catch (Exception e)
+            {
+                log.Error("Error while rendering frames for export.", e);
+                stageException = e;
+            }
+            finally
+            {
+                renderedQueue.CompleteAdding();
+            }
+        }
+
+        /// <summary>
+        /// Get a bitmap from the pool, allocating it if the pool hasn't reached its size yet, otherwise waiting for one to be returned.
+        /// </summary>
+        private Bitmap TakeBitmap(BlockingCollection<Bitmap> pool, ref int allocated, Size size, PixelFormat format, Bitmap paletteSource)
+        {
+            Bitmap bitmap;
+            if (pool.TryTake(out bitmap))
+                return bitmap;
+
+            if (allocated >= poolSize)
+                return pool.Take(cancellation.Token);
+
+            bitmap = new Bitmap(size.Width, size.Height, format);
+            if (paletteSource != null && IsIndexed(format))
+                bitmap.Palette = paletteSource.Palette;
+
+            lock (bitmaps)
+                bitmaps.Add(bitmap);
+
+            allocated++;
+            return bitmap;
+        }
+
+        private static bool IsIndexed(PixelFormat format)
+        {
+            return (format & PixelFormat.Indexed) == PixelFormat.Indexed;
+        }
+    }
+}
@@ -267,9 +267,14 @@ namespace Kinovea.ScreenManager
                 return;
             }
 
+            // Matroska can carry the analysis as a text stream, in which case the images are left clean.
+            bool embedKVA = PreferencesManager.PlayerPreferences.ExportEmbedKVA && 
+                metadata.HasData && 
+                FilesystemHelper.GetVideoFormat(fve.Filename) == KinoveaVideoFormat.MKV;
+
             DoSave(fve.Filename,
                    fve.UseSlowMotion ? playbackFrameInterval : metadata.UserInterval,
-                   true,
+                   !embedKVA,
                    false,
                    false,
                    imageRetriever);
@@ -376,12 +381,36 @@ namespace Kinovea.ScreenManager
             s.KeyframesOnly = keyframesOnly;
             s.PausedVideo = pausedVideo;
             s.ImageRetriever = imageRetriever;
+
+            if (!flushDrawings)
+            {
+                MetadataSerializer serializer = new MetadataSerializer();
+                s.Metadata = serializer.SaveToString(metadata);
+            }
             
             formProgressBar = new formProgressBar(true);
             formProgressBar.Cancel = Cancel_Asked;
             bgWorkerSave.RunWorkerAsync(s);
             formProgressBar.ShowDialog();
         }
+
+        /// <summary>
+        /// Whether the export can copy the compressed stream instead of decoding and encoding every frame.
+        /// The images must come out unchanged: nothing painted on top, no image option and same frame rate.
+        /// </summary>
+        private bool CanRemux(SavingSettings settings, string formatString)
+        {
+            if (settings.KeyframesOnly || settings.PausedVideo || settings.Duplication != 1)
+                return false;
+
+            if (metadata.HasData || metadata.Mirrored || metadata.TestGridVisible)
+                return false;
+
+            if (Math.Abs(settings.OutputFrameInterval - videoReader.Info.FrameIntervalMilliseconds) > 0.01)
+                return false;
+
+            return videoReader.CanRemux(settings.Section, formatString);
+        }
         
         #region Background worker event handlers
         private void bgWorkerSave_DoWork(object sender, DoWorkEventArgs e)
@@ -440,13 +469,29 @@ namespace Kinovea.ScreenManager
                 
                 log.DebugFormat("interval:{0}, duplication:{1}, kf duplication:{2}", settings.OutputFrameInterval, settings.Duplication, settings.KeyframeDuplication);
                 
-                videoReader.BeforeFrameEnumeration();
-                IEnumerable<Bitmap> images = EnumerateImages(settings);
-
-                VideoFileWriter w = new VideoFileWriter();
                 string formatString = FilenameHelper.GetFormatString(settings.File);
-                saveResult = w.Save(settings, videoReader.Info, formatString, images, bgWorker);
-                videoReader.AfterFrameEnumeration();
+                bool remuxed = false;
+                if (CanRemux(settings, formatString))
+                {
+                    log.Debug("Images unchanged, copying the compressed stream.");
+                    saveResult = videoReader.Remux(settings, formatString, bgWorker);
+                    remuxed = saveResult == SaveResult.Success || saveResult == SaveResult.Cancelled;
+                    if (!remuxed)
+                        log.ErrorFormat("Stream copy failed ({0}), falling back to transcoding.", saveResult);
+                }
+
+                if (!remuxed)
+                {
+                    videoReader.BeforeFrameEnumeration();
+                    ExportPipeline pipeline = new ExportPipeline(videoReader, settings);
+                    IEnumerable<Bitmap> images = pipeline.Enumerate();
+
+                    VideoFileWriter w = new VideoFileWriter();
+                    w.Benchmark = log.IsDebugEnabled;
+                    w.EncodingProfile = PreferencesManager.PlayerPreferences.VideoEncodingProfile;
+                    saveResult = w.Save(settings, videoReader.Info, formatString, images, bgWorker);
+                    videoReader.AfterFrameEnumeration();
+                }
             }
             catch (Exception exp)
             {
@@ -458,46 +503,6 @@ namespace Kinovea.ScreenManager
             e.Result = 0;
         }
         
-        /// <summary>
-        /// Lazily enumerate the images that will end up in the final file.
-        /// Return fully painted bitmaps ready for saving in the output.
-        /// In case of early cancellation or error, the caller must dispose the bitmap to avoid a leak.
-        /// </summary>
-        private IEnumerable<Bitmap> EnumerateImages(SavingSettings settings)
-        {
-            Bitmap output = null;
-
-            // Enumerates the raw frames from the video (at original video size).
-            foreach (VideoFrame vf in videoReader.FrameEnumerator())
-            {
-                if (vf == null)
-                {
-                    log.Error("Working zone enumerator yield null.");
-                    
-                    if (output != null)
-                        output.Dispose();
-
-                    yield break;
-                }
-
-                if (output == null)
-                    output = new Bitmap(vf.Image.Width, vf.Image.Height, vf.Image.PixelFormat);
-                
-                bool onKeyframe = settings.ImageRetriever(vf, output);
-                bool savable = onKeyframe || !settings.KeyframesOnly;
-
-                if (savable)
-                {
-                    int duplication = settings.PausedVideo && onKeyframe ? settings.KeyframeDuplication : settings.Duplication;
-                    for (int i = 0; i < duplication; i++)
-                        yield return output;
-                }
-            }
-
-            if (output != null)
-                output.Dispose();
-        }
-
         private void bgWorkerSave_ProgressChanged(object sender, ProgressChangedEventArgs e)
         {
             // This method should be called back from the writer when a frame has been processed.
@@ -593,12 +593,17 @@ namespace Kinovea.ScreenManager
             if (!recoveredMetadata)
             {
                 // Side-car KVA.
+                bool foundSidecar = false;
                 foreach (string extension in MetadataSerializer.SupportedFileFormats())
                 {
                     string candidate = Path.Combine(Path.GetDirectoryName(m_FrameServer.VideoReader.FilePath), Path.GetFileNameWithoutExtension(m_FrameServer.VideoReader.FilePath) + extension);
-                    LookForLinkedAnalysis(candidate);
+                    foundSidecar |= LookForLinkedAnalysis(candidate);
                 }
 
+                // Analysis muxed in the video file. The side-car is more recent if both exist.
+                if (!foundSidecar && m_FrameServer.VideoReader.Info.HasKva)
+                    LoadEmbeddedAnalysis();
+
                 // Startup KVA.
                 string startupFile = PreferencesManager.PlayerPreferences.PlaybackKVA;
                 if (!string.IsNullOrEmpty(startupFile))
@@ -1073,13 +1078,23 @@ namespace Kinovea.ScreenManager
             m_KeyframeCommentsHub = new formKeyframeComments(this);
             FormsHelper.MakeTopmost(m_KeyframeCommentsHub);
         }
-        private void LookForLinkedAnalysis(string file)
+        private bool LookForLinkedAnalysis(string file)
         {
-            if (File.Exists(file))
-            {
-                MetadataSerializer s = new MetadataSerializer();
-                s.Load(m_FrameServer.Metadata, file, true);
-            }
+            if (!File.Exists(file))
+                return false;
+            
+            MetadataSerializer s = new MetadataSerializer();
+            s.Load(m_FrameServer.Metadata, file, true);
+            return true;
+        }
+        private void LoadEmbeddedAnalysis()
+        {
+            string kva = m_FrameServer.VideoReader.ReadMetadata();
+            if (string.IsNullOrEmpty(kva))
+                return;
+
+            MetadataSerializer s = new MetadataSerializer();
+            s.Load(m_FrameServer.Metadata, kva, false);
         }
         private void UpdateInfobar()
         {
@@ -2197,7 +2212,9 @@ namespace Kinovea.ScreenManager
             // - Some decoding modes also prevent changing the decoding size, this is set in scalable here.
             // Note: do not update decoding scale here, as this function is called during stretching of the rendering surface, 
             // while the decoding size isn't updated. 
-            bool scalable = m_FrameServer.VideoReader.CanScaleIndefinitely || m_FrameServer.VideoReader.DecodingMode == VideoDecodingMode.PreBuffering;
+            bool scalable = m_FrameServer.VideoReader.CanScaleIndefinitely || 
+                m_FrameServer.VideoReader.DecodingMode == VideoDecodingMode.PreBuffering || 
+                m_FrameServer.VideoReader.DecodingMode == VideoDecodingMode.ReverseBuffering;
             bool rotatedCanvas = false;
             if (videoFilterIsActive)
                 rotatedCanvas = m_FrameServer.Metadata.ActiveVideoFilter.RotatedCanvas;
@@ -0,0 +1,413 @@
+﻿#region License
+/*
+Copyright © Joan Charmant 2011. jcharmant@gmail.com 
+Licensed under the MIT license: http://www.opensource.org/licenses/mit-license.php
+*/
+#endregion
+using System;
+using System.Collections.Generic;
+using System.Drawing;
+using System.Drawing.Imaging;
+using System.IO;
+using System.IO.MemoryMappedFiles;
+using System.Linq;
+
+using Kinovea.Services;
+using Kinovea.Video;
+
+namespace Kinovea.ScreenManager
+{
+    /// <summary>
+    /// Persistent store of video summaries, used to avoid opening the files again when browsing a known folder.
+    /// 
+    /// Entries are keyed by path, file size, last write time and thumbnail parameters, so a modified file simply misses.
+    /// All entries live in a single append-only file, mapped in memory for reading.
+    /// Each record is: [int32 length][int64 last access][payload]. The last access field is updated in place on hits.
+    /// When the file grows past the configured size, the least recently used entries are dropped and the file is rewritten.
+    /// </summary>
+    public static class SummaryCache
+    {
+        private class Entry
+        {
+            public long Offset;
+            public int Length;
+            public long LastAccess;
+        }
+
+        private static readonly object locker = new object();
+        private static bool initialized;
+        private static FileStream stream;
+        private static MemoryMappedFile mappedFile;
+        private static MemoryMappedViewAccessor accessor;
+        private static long mappedLength;
+        private static Dictionary<string, Entry> entries = new Dictionary<string, Entry>();
+        
+        private const int magic = 0x4353564B; // "KVSC".
+        private const int version = 2;
+        private const int headerSize = 8;
+        private const int recordHeaderSize = 12;
+        private const long megabyte = 1024 * 1024;
+        private const double compactionRatio = 0.75;
+        private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
+
+        /// <summary>
+        /// Returns the cached summary of the file, or null if the file is unknown or changed since it was cached.
+        /// </summary>
+        public static VideoSummary Get(string filename, int thumbs, Size maxImageSize)
+        {
+            string key = GetKey(filename, thumbs, maxImageSize);
+            if (key == null)
+                return null;
+
+            byte[] payload = null;
+            lock (locker)
+            {
+                if (!EnsureOpen())
+                    return null;
+
+                Entry entry;
+                if (!entries.TryGetValue(key, out entry))
+                    return null;
+
+                if (entry.Offset + entry.Length > mappedLength)
+                    Remap();
+
+                payload = new byte[entry.Length - recordHeaderSize];
+                accessor.ReadArray(entry.Offset + recordHeaderSize, payload, 0, payload.Length);
+
+                entry.LastAccess = DateTime.UtcNow.Ticks;
+                accessor.Write(entry.Offset + 4, entry.LastAccess);
+            }
+
+            try
+            {
+                return Deserialize(filename, key, payload);
+            }
+            catch (Exception e)
+            {
+                log.ErrorFormat("Invalid summary cache entry for {0}.", filename);
+                log.Error(e);
+                return null;
+            }
+        }
+
+        /// <summary>
+        /// Stores the summary of the file. Summaries without thumbnails are not cached so the extraction is tried again next time.
+        /// </summary>
+        public static void Add(VideoSummary summary, int thumbs, Size maxImageSize)
+        {
+            if (summary == null || summary.Thumbs.Count == 0)
+                return;
+
+            string key = GetKey(summary.Filename, thumbs, maxImageSize);
+            if (key == null)
+                return;
+
+            // Encode outside the lock, this is the expensive part.
+            byte[] payload = Serialize(key, summary);
+
+            lock (locker)
+            {
+                if (!EnsureOpen() || entries.ContainsKey(key))
+                    return;
+
+                try
+                {
+                    Entry entry = new Entry();
+                    entry.Offset = stream.Length;
+                    entry.Length = recordHeaderSize + payload.Length;
+                    entry.LastAccess = DateTime.UtcNow.Ticks;
+
+                    stream.Seek(0, SeekOrigin.End);
+                    BinaryWriter writer = new BinaryWriter(stream);
+                    writer.Write(entry.Length - 4);
+                    writer.Write(entry.LastAccess);
+                    writer.Write(payload);
+                    writer.Flush();
+
+                    entries.Add(key, entry);
+
+                    if (stream.Length > GetMaxSize())
+                        Compact();
+                }
+                catch (Exception e)
+                {
+                    log.Error("Error while writing to the summary cache.");
+                    log.Error(e);
+                    Close();
+                    initialized = true;
+                }
+            }
+        }
+
+        /// <summary>
+        /// Flushes and releases the cache file. It will be opened again on the next access.
+        /// </summary>
+        public static void Close()
+        {
+            lock (locker)
+            {
+                ReleaseMapping();
+
+                if (stream != null)
+                {
+                    stream.Dispose();
+                    stream = null;
+                }
+
+                entries.Clear();
+                initialized = false;
+            }
+        }
+
+        private static string GetKey(string filename, int thumbs, Size maxImageSize)
+        {
+            if (string.IsNullOrEmpty(filename) || GetMaxSize() <= 0)
+                return null;
+
+            FileInfo info = new FileInfo(filename);
+            if (!info.Exists)
+                return null;
+
+            return string.Format("{0}|{1}|{2}|{3}x{4}|{5}", info.FullName.ToLowerInvariant(), info.Length, info.LastWriteTimeUtc.Ticks, maxImageSize.Width, maxImageSize.Height, thumbs);
+        }
+
+        private static long GetMaxSize()
+        {
+            return PreferencesManager.FileExplorerPreferences.SummaryCacheSize * megabyte;
+        }
+
+        private static string GetCacheFile()
+        {
+            if (string.IsNullOrEmpty(Software.CacheDirectory))
+                return null;
+
+            return Path.Combine(Software.CacheDirectory, "Summaries.cache");
+        }
+
+        private static bool EnsureOpen()
+        {
+            if (initialized)
+                return stream != null;
+
+            // Only try once per session. If another instance owns the file we just run without cache.
+            initialized = true;
+            string path = GetCacheFile();
+            if (path == null)
+                return false;
+
+            try
+            {
+                Directory.CreateDirectory(Path.GetDirectoryName(path));
+                stream = new FileStream(path, FileMode.OpenOrCreate, FileAccess.ReadWrite, FileShare.None);
+                Load();
+                log.DebugFormat("Summary cache opened, {0} entries, {1} bytes.", entries.Count, stream.Length);
+            }
+            catch (Exception e)
+            {
+                log.Error("Could not open the summary cache.");
+                log.Error(e);
+                if (stream != null)
+                {
+                    stream.Dispose();
+                    stream = null;
+                }
+            }
+
+            return stream != null;
+        }
+
+        /// <summary>
+        /// Rebuilds the index by scanning the records. A truncated record at the end (interrupted write) is discarded.
+        /// </summary>
+        private static void Load()
+        {
+            entries.Clear();
+
+            BinaryReader reader = new BinaryReader(stream);
+            stream.Seek(0, SeekOrigin.Begin);
+            if (stream.Length < headerSize || reader.ReadInt32() != magic || reader.ReadInt32() != version)
+            {
+                stream.SetLength(0);
+                BinaryWriter writer = new BinaryWriter(stream);
+                writer.Write(magic);
+                writer.Write(version);
+                writer.Flush();
+            }
+            else
+            {
+                long position = headerSize;
+                long fileLength = stream.Length;
+                while (position + recordHeaderSize <= fileLength)
+                {
+                    stream.Seek(position, SeekOrigin.Begin);
+                    int length = reader.ReadInt32() + 4;
+                    if (length <= recordHeaderSize || position + length > fileLength)
+                        break;
+
+                    Entry entry = new Entry();
+                    entry.Offset = position;
+                    entry.Length = length;
+                    entry.LastAccess = reader.ReadInt64();
+                    entries[reader.ReadString()] = entry;
+
+                    position += length;
+                }
+
+                if (position != fileLength)
+                {
+                    log.WarnFormat("Summary cache truncated at {0} bytes.", position);
+                    stream.SetLength(position);
+                }
+            }
+
+            Remap();
+        }
+
+        private static void Remap()
+        {
+            ReleaseMapping();
+            mappedFile = MemoryMappedFile.CreateFromFile(stream, null, 0, MemoryMappedFileAccess.ReadWrite, null, HandleInheritability.None, true);
+            accessor = mappedFile.CreateViewAccessor();
+            mappedLength = stream.Length;
+        }
+
+        private static void ReleaseMapping()
+        {
+            if (accessor != null)
+            {
+                accessor.Dispose();
+                accessor = null;
+            }
+
+            if (mappedFile != null)
+            {
+                mappedFile.Dispose();
+                mappedFile = null;
+            }
+
+            mappedLength = 0;
+        }
+
+        /// <summary>
+        /// Rewrites the file with the most recently used entries only, down to a fraction of the maximum size.
+        /// </summary>
+        private static void Compact()
+        {
+            string path = GetCacheFile();
+            string tempPath = path + ".tmp";
+            long target = (long)(GetMaxSize() * compactionRatio);
+            int before = entries.Count;
+
+            Remap();
+            
+            Dictionary<string, Entry> kept = new Dictionary<string, Entry>();
+            using (FileStream output = new FileStream(tempPath, FileMode.Create, FileAccess.Write, FileShare.None))
+            {
+                BinaryWriter writer = new BinaryWriter(output);
+                writer.Write(magic);
+                writer.Write(version);
+
+                long size = headerSize;
+                byte[] buffer = new byte[0];
+                foreach (var pair in entries.OrderByDescending(p => p.Value.LastAccess))
+                {
+                    Entry entry = pair.Value;
+                    if (size + entry.Length > target)
+                        break;
+
+                    if (buffer.Length < entry.Length)
+                        buffer = new byte[entry.Length];
+
+                    accessor.ReadArray(entry.Offset, buffer, 0, entry.Length);
+                    
+                    Entry moved = new Entry();
+                    moved.Offset = size;
+                    moved.Length = entry.Length;
+                    moved.LastAccess = entry.LastAccess;
+                    kept.Add(pair.Key, moved);
+
+                    writer.Write(buffer, 0, entry.Length);
+                    size += entry.Length;
+                }
+
+                writer.Flush();
+            }
+
+            ReleaseMapping();
+            stream.Dispose();
+            File.Delete(path);
+            File.Move(tempPath, path);
+            
+            stream = new FileStream(path, FileMode.Open, FileAccess.ReadWrite, FileShare.None);
+            entries = kept;
+            Remap();
+
+            log.DebugFormat("Summary cache compacted, {0} entries evicted, {1} bytes.", before - entries.Count, stream.Length);
+        }
+
+        private static byte[] Serialize(string key, VideoSummary summary)
+        {
+            using (MemoryStream ms = new MemoryStream())
+            {
+                BinaryWriter writer = new BinaryWriter(ms);
+                writer.Write(key);
+                writer.Write(summary.IsImage);
+                writer.Write(summary.ImageSize.Width);
+                writer.Write(summary.ImageSize.Height);
+                writer.Write(summary.DurationMilliseconds);
+                writer.Write(summary.Framerate);
+                writer.Write(summary.HasKva);
+                writer.Write(summary.Thumbs.Count);
+
+                foreach (Bitmap thumb in summary.Thumbs)
+                {
+                    using (MemoryStream thumbStream = new MemoryStream())
+                    {
+                        // Lossless, so a cache hit looks the same as a fresh extraction.
+                        thumb.Save(thumbStream, System.Drawing.Imaging.ImageFormat.Png);
+                        writer.Write((int)thumbStream.Length);
+                        thumbStream.WriteTo(ms);
+                    }
+                }
+
+                writer.Flush();
+                return ms.ToArray();
+            }
+        }
+
+        private static VideoSummary Deserialize(string filename, string key, byte[] payload)
+        {
+            using (MemoryStream ms = new MemoryStream(payload))
+            {
+                BinaryReader reader = new BinaryReader(ms);
+                if (reader.ReadString() != key)
+                    return null;
+
+                VideoSummary summary = new VideoSummary(filename);
+                summary.IsImage = reader.ReadBoolean();
+                int width = reader.ReadInt32();
+                int height = reader.ReadInt32();
+                summary.ImageSize = new Size(width, height);
+                summary.DurationMilliseconds = reader.ReadInt64();
+                summary.Framerate = reader.ReadDouble();
+
+                // The flag may come from an analysis stream embedded in the file, on top of the companion file check.
+                summary.HasKva |= reader.ReadBoolean();
+                
+                int count = reader.ReadInt32();
+                for (int i = 0; i < count; i++)
+                {
+                    int length = reader.ReadInt32();
+                    using (MemoryStream thumbStream = new MemoryStream(payload, (int)ms.Position, length))
+                    using (Bitmap decoded = new Bitmap(thumbStream))
+                        summary.Thumbs.Add(new Bitmap(decoded));
+
+                    ms.Seek(length, SeekOrigin.Current);
+                }
+
+                return summary;
+            }
+        }
+    }
+}
@@ -12,6 +12,7 @@ namespace Kinovea.ScreenManager
     public class SummaryLoadedEventArgs : EventArgs
     {
         public readonly VideoSummary Summary;
+        // Number of summaries loaded so far, including this one.
         public readonly int Progress;
         public SummaryLoadedEventArgs(VideoSummary summary, int progress)
         {
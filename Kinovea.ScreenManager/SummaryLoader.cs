@@ -16,6 +16,13 @@ using Kinovea.Video;
 
 namespace Kinovea.ScreenManager
 {
+    /// <summary>
+    /// Extracts the summaries (info and thumbnails) of a list of files in the background.
+    /// The files are dispatched to a bounded number of worker threads, each using its own reader instances.
+    /// Files are processed in the order of the list, which can be changed while loading to favor the visible thumbnails.
+    /// Summaries are raised on the UI thread as soon as they are ready.
+    /// Files already known to the summary cache are not opened at all.
+    /// </summary>
     public class SummaryLoader
     {
         public bool IsAlive 
@@ -29,14 +36,27 @@ namespace Kinovea.ScreenManager
         private bool cancellationPending;
         private List<String> filenames;
         private Size maxImageSize;
+        private int maxDegreeOfParallelism;
         private BackgroundWorker bgWorker = new BackgroundWorker();
+        private ThreadCanceler canceler = new ThreadCanceler();
+        private object locker = new object();
+        private List<string> pending = new List<string>();
+        private Queue<VideoSummary> results = new Queue<VideoSummary>();
+        private int runningWorkers;
         private const int thumbnailsToExtract = 5;
+        private const int maxWorkers = 16;
         private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
         
         public SummaryLoader(List<String> filenames, Size maxImageSize)
+            : this(filenames, maxImageSize, 0)
         {
+        }
+        public SummaryLoader(List<String> filenames, Size maxImageSize, int maxDegreeOfParallelism)
+        {
+            // maxDegreeOfParallelism: number of files processed at the same time, 0 means automatic.
             this.filenames = filenames;
             this.maxImageSize = maxImageSize;
+            this.maxDegreeOfParallelism = maxDegreeOfParallelism;
         }
         public void Run()
         {
@@ -55,11 +75,33 @@ namespace Kinovea.ScreenManager
         {
             cancellationPending = true;
             bgWorker.CancelAsync();
+
+            // Readers check the canceler between frames, so the workers stop within one frame decode.
+            lock (locker)
+            {
+                canceler.Cancel();
+                Monitor.PulseAll(locker);
+            }
+        }
+
+        /// <summary>
+        /// Move the passed files to the front of the queue, for example the thumbnails currently visible.
+        /// Files already extracted or being extracted are ignored.
+        /// </summary>
+        public void Prioritize(List<string> files)
+        {
+            lock (locker)
+            {
+                for (int i = files.Count - 1; i >= 0; i--)
+                {
+                    if (pending.Remove(files[i]))
+                        pending.Insert(0, files[i]);
+                }
+            }
         }
         private void bgWorker_DoWork(object sender, DoWorkEventArgs e)
         {
-            // Note: having one background worker per file and running them all in parallel was tested
-            // but it does more harm than good.
+            // The background worker only dispatches the files to the extraction threads and reports the results.
             BackgroundWorker bgWorker = sender as BackgroundWorker;
             List<string> filenames = e.Argument as List<string>;
             
@@ -69,36 +111,129 @@ namespace Kinovea.ScreenManager
         	    return;
         	}
 
-            for (int i = 0; i<filenames.Count; i++)
+            int workers = Math.Min(filenames.Count, GetDegreeOfParallelism());
+            log.DebugFormat("Extracting {0} summaries on {1} threads.", filenames.Count, workers);
+            Stopwatch stopwatch = Stopwatch.StartNew();
+
+            List<Thread> threads = new List<Thread>();
+            lock (locker)
+            {
+                pending.AddRange(filenames);
+                runningWorkers = workers;
+            }
+
+            for (int i = 0; i < workers; i++)
+            {
+                Thread thread = new Thread(Worker);
+                thread.Name = "SummaryLoader " + i;
+                thread.IsBackground = true;
+                thread.Priority = ThreadPriority.BelowNormal;
+                threads.Add(thread);
+                thread.Start();
+            }
+
+            int loaded = 0;
+            while (true)
             {
-                if(bgWorker.CancellationPending)
-                    break;
-                
-                string filename = filenames[i];
                 VideoSummary summary = null;
-               
-                try
+                lock (locker)
                 {
-                    if(string.IsNullOrEmpty(filename))
-                       continue;
-                    
-                    string extension = Path.GetExtension(filename);
-                    VideoReader reader = VideoTypeManager.GetVideoReader(extension);
+                    while (results.Count == 0 && runningWorkers > 0 && !canceler.CancellationPending)
+                        Monitor.Wait(locker);
 
-        			if(reader != null)
-                        summary = reader.ExtractSummary(filename, thumbnailsToExtract, maxImageSize);
+                    if (canceler.CancellationPending || results.Count == 0)
+                        break;
+
+                    summary = results.Dequeue();
+                }
+
+                loaded++;
+                bgWorker.ReportProgress(loaded, summary);
+            }
+
+            foreach (Thread thread in threads)
+                thread.Join();
+
+            log.DebugFormat("Extracted {0} summaries in {1} ms.", loaded, stopwatch.ElapsedMilliseconds);
+        }
+        private void Worker()
+        {
+            // Readers are reused for all the files of the same type handled by this thread.
+            Dictionary<string, VideoReader> readers = new Dictionary<string, VideoReader>();
+
+            while (!canceler.CancellationPending)
+            {
+                string filename;
+                lock (locker)
+                {
+                    if (pending.Count == 0)
+                        break;
+
+                    filename = pending[0];
+                    pending.RemoveAt(0);
+                }
+
+                VideoSummary summary = ExtractSummary(filename, readers);
+
+                lock (locker)
+                {
+                    results.Enqueue(summary);
+                    Monitor.PulseAll(locker);
                 }
-                catch(Exception exp)
+            }
+
+            lock (locker)
+            {
+                runningWorkers--;
+                Monitor.PulseAll(locker);
+            }
+        }
+        private VideoSummary ExtractSummary(string filename, Dictionary<string, VideoReader> readers)
+        {
+            VideoSummary summary = SummaryCache.Get(filename, thumbnailsToExtract, maxImageSize);
+            if (summary != null)
+                return summary;
+
+            try
+            {
+                if (!string.IsNullOrEmpty(filename))
                 {
-                    log.ErrorFormat("Error while extracting video summary for {0}.", filename);
-                    log.Error(exp);
+                    string extension = Path.GetExtension(filename);
+                    VideoReader reader;
+                    if (!readers.TryGetValue(extension, out reader))
+                    {
+                        reader = VideoTypeManager.GetVideoReader(extension);
+                        readers.Add(extension, reader);
+                    }
+
+                    if (reader != null)
+                    {
+                        reader.SummaryCanceler = canceler;
+                        summary = reader.ExtractSummary(filename, thumbnailsToExtract, maxImageSize);
+
+                        // Extraction may have been cut short, don't keep a partial summary.
+                        if (!canceler.CancellationPending)
+                            SummaryCache.Add(summary, thumbnailsToExtract, maxImageSize);
+                    }
                 }
-                
-                if(summary == null)
-                    summary = new VideoSummary(filename);
-                
-    			bgWorker.ReportProgress(i, summary);
             }
+            catch (Exception exp)
+            {
+                log.ErrorFormat("Error while extracting video summary for {0}.", filename);
+                log.Error(exp);
+            }
+
+            if (summary == null)
+                summary = new VideoSummary(filename);
+
+            return summary;
+        }
+        private int GetDegreeOfParallelism()
+        {
+            if (maxDegreeOfParallelism > 0)
+                return Math.Min(maxDegreeOfParallelism, maxWorkers);
+
+            return Math.Max(1, Math.Min(Environment.ProcessorCount, maxWorkers));
         }
         private void bgWorker_ProgressChanged(object sender, ProgressChangedEventArgs e)
         {
@@ -64,6 +64,8 @@ namespace Kinovea.ScreenManager
             this.Dock = DockStyle.Fill;
 
             NotificationCenter.FileSelected += NotificationCenter_FileSelected;
+            this.Scroll += (s, e) => PrioritizeVisibleThumbnails();
+            this.MouseWheel += (s, e) => PrioritizeVisibleThumbnails();
 
             this.Hotkeys = HotkeySettingsManager.LoadHotkeys("ThumbnailViewerFiles");
 
@@ -173,7 +175,8 @@ namespace Kinovea.ScreenManager
             CreateThumbs(files);
             Size maxImageSize = DoLayout();
 
-            SummaryLoader sl = new SummaryLoader(files, maxImageSize);
+            int threads = PreferencesManager.FileExplorerPreferences.SummaryThreads;
+            SummaryLoader sl = new SummaryLoader(files, maxImageSize, threads);
             sl.SummaryLoaded += SummaryLoader_SummaryLoaded;
             loaders.Add(sl);
             if (BeforeLoad != null)
@@ -227,7 +230,7 @@ namespace Kinovea.ScreenManager
                 }
             }
             
-            int done = e.Progress+1;
+            int done = e.Progress;
             int percentage = (int)(((float)done / thumbnails.Count) * 100);
             
             if(ProgressChanged != null)
@@ -273,6 +276,25 @@ namespace Kinovea.ScreenManager
 
             return maxImageSize;
         }
+        private void PrioritizeVisibleThumbnails()
+        {
+            // Ask the loaders to extract the summaries of the thumbnails in view first.
+            if (loaders.Count == 0)
+                return;
+
+            List<string> visible = new List<string>();
+            foreach (ThumbnailFile thumbnail in SortedAndFilteredThumbs())
+            {
+                if (thumbnail.Bounds.IntersectsWith(this.ClientRectangle))
+                    visible.Add(thumbnail.FileName);
+            }
+
+            foreach (SummaryLoader loader in loaders)
+            {
+                if (loader.IsAlive)
+                    loader.Prioritize(visible);
+            }
+        }
         private IEnumerable<ThumbnailFile> SortedAndFilteredThumbs()
         {
             foreach(ThumbnailFile tlvi in thumbnails)
@@ -10,11 +10,25 @@ namespace Kinovea.Services
     /// Collects a series of duration/bytes pairs. Caller should invoke the Post() method passing values.
     /// This class is not thread-safe. Each thread should have its own counter.
     /// Computes total, bandwidth, average duration, median duration, standard deviation, 95th and 99th percentiles duration.
+    ///
+    /// Also collects a histogram of consumer lag, the number of frames the producer is ahead when an entry is read.
+    /// The histogram is preallocated and may be read from another thread while it is filled, values are then approximate.
     /// </summary>
     public class BenchmarkCounterBandwidth : IBenchmarkCounter
     {
+        /// <summary>
+        /// Lag histogram. Bucket i counts entries read while the producer was i frames ahead, the last bucket collects everything above.
+        /// </summary>
+        public int[] LagHistogram
+        {
+            get { return (int[])lagHistogram.Clone(); }
+        }
+
         private List<int> durations = new List<int>(5000);
         private List<int> sizes = new List<int>(5000);
+        private const int lagBuckets = 64;
+        private int[] lagHistogram = new int[lagBuckets];
+        private long lagSamples;
 
         /// <summary>
         /// Add a value to the counter.
@@ -25,15 +39,27 @@ namespace Kinovea.Services
             sizes.Add(size);
         }
 
+        /// <summary>
+        /// Add a lag value to the histogram.
+        /// </summary>
+        public void PostLag(long lag)
+        {
+            int bucket = (int)Math.Max(0, Math.Min(lag, lagBuckets - 1));
+            lagHistogram[bucket]++;
+            lagSamples++;
+        }
+
         /// <summary>
         /// Retrieve metrics about the values.
         /// </summary>
         public Dictionary<string, float> GetMetrics()
         {
-            if (durations.Count == 0)
+            if (durations.Count == 0 && lagSamples == 0)
                 return null;
 
             Dictionary<string, float> metrics = new Dictionary<string, float>();
+            AddLagMetrics(metrics);
+
             if (durations.Count < 50)
                 return metrics;
 
@@ -73,6 +99,43 @@ namespace Kinovea.Services
             return metrics;
         }
 
+        private void AddLagMetrics(Dictionary<string, float> metrics)
+        {
+            int[] histogram = LagHistogram;
+            long samples = histogram.Sum(count => (long)count);
+            if (samples == 0)
+                return;
+
+            long total = 0;
+            int max = 0;
+            for (int i = 0; i < histogram.Length; i++)
+            {
+                total += (long)i * histogram[i];
+                if (histogram[i] > 0)
+                    max = i;
+            }
+
+            metrics.Add("AverageLag", (float)total / samples);
+            metrics.Add("MedianLag", GetHistogramPercentile(histogram, samples, 0.5f));
+            metrics.Add("Percentile95Lag", GetHistogramPercentile(histogram, samples, 0.95f));
+            metrics.Add("Percentile99Lag", GetHistogramPercentile(histogram, samples, 0.99f));
+            metrics.Add("MaxLag", max);
+        }
+
+        private int GetHistogramPercentile(int[] histogram, long samples, float n)
+        {
+            long rank = (long)(n * samples);
+            long cumulated = 0;
+            for (int i = 0; i < histogram.Length; i++)
+            {
+                cumulated += histogram[i];
+                if (cumulated > rank)
+                    return i;
+            }
+
+            return histogram.Length - 1;
+        }
+
         private int GetPercentile(List<int> vv, float n)
         {
             int index = (int)(n * vv.Count);
@@ -6,12 +6,16 @@ using System.Drawing;
 using System.Drawing.Imaging;
 using System.Runtime.InteropServices;
 using System.IO;
+using Microsoft.Win32.SafeHandles;
 using TurboJpegNet;
 
 namespace Kinovea.Services
 {
     public static class BitmapHelper
     {
+        [ThreadStatic]
+        private static JpegDecompressorHandle jpegDecompressor;
+        private static readonly int[] jpegScalingDenominators = new int[] { 2, 4 };
         private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
 
         #region Copy a bitmap into another
@@ -60,6 +64,43 @@ namespace Kinovea.Services
             return;
         }
 
+        /// <summary>
+        /// Copy a bitmap into a region of a larger one, with its top-left corner at the passed location.
+        /// Both bitmaps must have the same pixel format and the source must fit in the destination.
+        /// </summary>
+        public unsafe static void CopyToLocation(Bitmap src, Bitmap dst, Point location)
+        {
+            BitmapData srcData = null;
+            BitmapData dstData = null;
+            try
+            {
+                srcData = src.LockBits(new Rectangle(Point.Empty, src.Size), ImageLockMode.ReadOnly, src.PixelFormat);
+                dstData = dst.LockBits(new Rectangle(location, src.Size), ImageLockMode.WriteOnly, dst.PixelFormat);
+
+                int rowLength = src.Width * Image.GetPixelFormatSize(src.PixelFormat) / 8;
+                byte* pSrc = (byte*)srcData.Scan0.ToPointer();
+                byte* pDst = (byte*)dstData.Scan0.ToPointer();
+                for (int i = 0; i < srcData.Height; i++)
+                {
+                    NativeMethods.memcpy(pDst, pSrc, rowLength);
+                    pSrc += srcData.Stride;
+                    pDst += dstData.Stride;
+                }
+            }
+            catch (Exception e)
+            {
+                log.ErrorFormat("Error while copying bitmaps. {0}", e.Message);
+            }
+            finally
+            {
+                if (dstData != null)
+                    dst.UnlockBits(dstData);
+
+                if (srcData != null)
+                    src.UnlockBits(srcData);
+            }
+        }
+
         /// <summary>
         /// Allocate a new bitmap and copy a grayscale version of the source into it.
         /// The source bitmap MUST be 4 bytes per pixel.
@@ -257,33 +298,72 @@ namespace Kinovea.Services
         }
 
         /// <summary>
-        /// Copy the buffer into the bitmap.
+        /// Decode the buffer into the bitmap.
         /// The buffer is assumed JPEG. 
-        /// The Bitmap should be RGB24, already allocated.
-        /// The decoded array should already be allocated and big enough to hold the RGB24 frame bytes.
+        /// The Bitmap should be RGB24, already allocated, either at the image size or at a reduced size from GetJPEGScaledSize.
         /// </summary>
-        public static void FillFromJPEG(Bitmap bitmap, Rectangle rect, byte[] decoded, byte[] buffer, int payloadLength, int pitch)
+        public static bool FillFromJPEG(Bitmap bitmap, byte[] buffer, int payloadLength)
         {
-            // Convert JPEG to RGB24 buffer then to bitmap.
-            // Assumes the JPEG width is a multiple of 4.
+            // The decompressor is created once per thread and released when the thread is gone.
+            if (jpegDecompressor == null)
+                jpegDecompressor = new JpegDecompressorHandle();
 
-            IntPtr handle = tjnet.tjInitDecompress();
+            if (jpegDecompressor.IsInvalid)
+                return false;
 
-            uint jpegSize = (uint)payloadLength;
-            int width;
-            int height;
-            TJSAMP jpegSubsamp;
-            tjnet.tjDecompressHeader2(handle, buffer, jpegSize, out width, out height, out jpegSubsamp);
+            // Decode straight into the bitmap memory.
+            // When the bitmap is smaller than the image, turbojpeg picks the matching scaling factor and skips part of the IDCT work.
+            Rectangle rect = new Rectangle(0, 0, bitmap.Width, bitmap.Height);
+            BitmapData bmpData = bitmap.LockBits(rect, ImageLockMode.WriteOnly, bitmap.PixelFormat);
+            int result;
+            try
+            {
+                result = NativeMethods.tjDecompress2(jpegDecompressor, buffer, (uint)payloadLength, bmpData.Scan0,
+                    bitmap.Width, bmpData.Stride, bitmap.Height, (int)TJPF.TJPF_BGR, (int)TJFLAG.TJFLAG_FASTDCT);
+            }
+            finally
+            {
+                bitmap.UnlockBits(bmpData);
+            }
 
-            tjnet.tjDecompress2(handle, buffer, jpegSize, decoded, width, pitch, height, TJPF.TJPF_BGR, TJFLAG.TJFLAG_FASTDCT);
+            return result == 0;
+        }
 
-            tjnet.tjDestroy(handle);
+        /// <summary>
+        /// Returns the smallest reduced JPEG decoding size that still covers the target size.
+        /// </summary>
+        public static Size GetJPEGScaledSize(Size imageSize, Size targetSize)
+        {
+            Size result = imageSize;
+            foreach (int denominator in jpegScalingDenominators)
+            {
+                // Same rounding as TJSCALED.
+                Size scaled = new Size((imageSize.Width + denominator - 1) / denominator, (imageSize.Height + denominator - 1) / denominator);
+                if (scaled.Width < targetSize.Width || scaled.Height < targetSize.Height)
+                    break;
 
-            // Encapsulate into bitmap.
-            // Fixme: do we need the copy here? What about getting an IntPtr from tjnet and setting it to scan0?
-            BitmapData bmpData = bitmap.LockBits(rect, ImageLockMode.ReadWrite, bitmap.PixelFormat);
-            Marshal.Copy(decoded, 0, bmpData.Scan0, bmpData.Stride * bitmap.Height);
-            bitmap.UnlockBits(bmpData);
+                result = scaled;
+            }
+
+            return result;
+        }
+
+        /// <summary>
+        /// Owns a turbojpeg decompressor. The native handle is destroyed when the wrapper is collected,
+        /// after the thread that created it has exited.
+        /// </summary>
+        private sealed class JpegDecompressorHandle : SafeHandleZeroOrMinusOneIsInvalid
+        {
+            public JpegDecompressorHandle()
+                : base(true)
+            {
+                SetHandle(NativeMethods.tjInitDecompress());
+            }
+
+            protected override bool ReleaseHandle()
+            {
+                return NativeMethods.tjDestroy(handle) == 0;
+            }
         }
 
         #endregion
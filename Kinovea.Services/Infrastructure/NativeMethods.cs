@@ -10,5 +10,15 @@ namespace Kinovea.Services
     {
         [DllImport("msvcrt.dll", EntryPoint = "memcpy", CallingConvention = CallingConvention.Cdecl, SetLastError = false)]
         public static unsafe extern int memcpy(void* dest, void* src, int count);
+
+        // The TurboJpegNet wrapper only decompresses to managed arrays, this variant writes to native memory.
+        [DllImport("turbojpeg.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr tjInitDecompress();
+
+        [DllImport("turbojpeg.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int tjDecompress2(SafeHandle handle, byte[] jpegBuf, uint jpegSize, IntPtr dstBuf, int width, int pitch, int height, int pixelFormat, int flags);
+
+        [DllImport("turbojpeg.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int tjDestroy(IntPtr handle);
     }
 }
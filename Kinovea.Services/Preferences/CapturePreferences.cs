@@ -82,6 +82,12 @@ namespace Kinovea.Services
             get { return saveUncompressedVideo; }
             set { saveUncompressedVideo = value; }
         }
+        public int RecordingEncoderThreads
+        {
+            // Number of threads compressing frames in parallel during recording. 0 means automatic, 1 (the default) disables parallel encoding.
+            get { return recordingEncoderThreads; }
+            set { recordingEncoderThreads = value; }
+        }
         public CaptureAutomationConfiguration CaptureAutomationConfiguration
         {
             get { return captureAutomationConfiguration; }
@@ -124,6 +130,7 @@ namespace Kinovea.Services
         private double displaySynchronizationFramerate = 25.0;
         private CaptureRecordingMode recordingMode = CaptureRecordingMode.Camera;
         private bool saveUncompressedVideo;
+        private int recordingEncoderThreads = 1;
         private bool verboseStats = false;
         private int memoryBuffer = 768;
         private Dictionary<string, CameraBlurb> cameraBlurbs = new Dictionary<string, CameraBlurb>();
@@ -164,6 +171,7 @@ namespace Kinovea.Services
             writer.WriteElementString("CaptureRecordingMode", recordingMode.ToString());
             writer.WriteElementString("VerboseStats", verboseStats ? "true" : "false");
             writer.WriteElementString("SaveUncompressedVideo", saveUncompressedVideo ? "true" : "false");
+            writer.WriteElementString("RecordingEncoderThreads", recordingEncoderThreads.ToString());
             
             writer.WriteElementString("MemoryBuffer", memoryBuffer.ToString());
             
@@ -227,6 +235,9 @@ namespace Kinovea.Services
                     case "SaveUncompressedVideo":
                         saveUncompressedVideo = XmlHelper.ParseBoolean(reader.ReadElementContentAsString());
                         break;
+                    case "RecordingEncoderThreads":
+                        recordingEncoderThreads = reader.ReadElementContentAsInt();
+                        break;
                     case "VerboseStats":
                         verboseStats = XmlHelper.ParseBoolean(reader.ReadElementContentAsString());
                         break;
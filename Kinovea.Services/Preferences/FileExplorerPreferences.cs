@@ -117,6 +117,18 @@ namespace Kinovea.Services
             get { return lastReplayFolder; }
             set { lastReplayFolder = value; }
         }
+        public int SummaryThreads
+        {
+            // Number of files processed in parallel when extracting thumbnails. 0 means automatic.
+            get { return summaryThreads; }
+            set { summaryThreads = value; }
+        }
+        public int SummaryCacheSize
+        {
+            // Maximum size of the thumbnails cache file in megabytes. 0 disables the cache.
+            get { return summaryCacheSize; }
+            set { summaryCacheSize = value; }
+        }
 
         private int maxRecentFiles = 10;
         private int maxRecentCapturedFiles = 10;
@@ -131,6 +143,8 @@ namespace Kinovea.Services
         private string lastBrowsedDirectory;
         private FilePropertyVisibility filePropertyVisibility = new FilePropertyVisibility();
         private string lastReplayFolder;
+        private int summaryThreads = 0;
+        private int summaryCacheSize = 256;
         
         public void AddRecentFile(string file)
         {
@@ -245,6 +259,8 @@ namespace Kinovea.Services
             writer.WriteEndElement();
 
             writer.WriteElementString("LastReplayFolder", lastReplayFolder);
+            writer.WriteElementString("SummaryThreads", summaryThreads.ToString());
+            writer.WriteElementString("SummaryCacheSize", summaryCacheSize.ToString());
         }
 
         private void WriteRecents(XmlWriter writer, List<string> recentFiles, int max, string collectionTag, string itemTag)
@@ -312,6 +328,12 @@ namespace Kinovea.Services
                     case "LastReplayFolder":
                         lastReplayFolder = reader.ReadElementContentAsString();
                         break;
+                    case "SummaryThreads":
+                        summaryThreads = reader.ReadElementContentAsInt();
+                        break;
+                    case "SummaryCacheSize":
+                        summaryCacheSize = reader.ReadElementContentAsInt();
+                        break;
                     default:
                         reader.ReadOuterXml();
                         break;
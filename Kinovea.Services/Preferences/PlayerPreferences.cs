@@ -139,6 +139,20 @@ namespace Kinovea.Services
             get { return videoFormat; }
             set { videoFormat = value; }
         }
+        public VideoEncodingProfile VideoEncodingProfile
+        {
+            get { return videoEncodingProfile; }
+            set { videoEncodingProfile = value; }
+        }
+        /// <summary>
+        /// Export videos with the analysis muxed in the file instead of painted on the images.
+        /// Only used for Matroska files.
+        /// </summary>
+        public bool ExportEmbedKVA
+        {
+            get { return exportEmbedKVA; }
+            set { exportEmbedKVA = value; }
+        }
         public TrackingProfile TrackingProfile
         {
             get { return trackingProfile; }
@@ -209,6 +223,8 @@ namespace Kinovea.Services
         private bool syncByMotion = false;
         private KinoveaImageFormat imageFormat = KinoveaImageFormat.JPG;
         private KinoveaVideoFormat videoFormat = KinoveaVideoFormat.MKV;
+        private VideoEncodingProfile videoEncodingProfile = VideoEncodingProfile.Mpeg4Intra;
+        private bool exportEmbedKVA = false;
         private TrackingProfile trackingProfile = new TrackingProfile();
         private bool enableFiltering = true;
         private bool enableHighSpeedDerivativesSmoothing = true;
@@ -243,6 +259,8 @@ namespace Kinovea.Services
             writer.WriteElementString("SyncByMotion", syncByMotion ? "true" : "false");
             writer.WriteElementString("ImageFormat", imageFormat.ToString());
             writer.WriteElementString("VideoFormat", videoFormat.ToString());
+            writer.WriteElementString("VideoEncodingProfile", videoEncodingProfile.ToString());
+            writer.WriteElementString("ExportEmbedKVA", exportEmbedKVA ? "true" : "false");
             writer.WriteElementString("Background", XmlHelper.WriteColor(backgroundColor, true));
             
             writer.WriteStartElement("InfoFading");
@@ -342,6 +360,12 @@ namespace Kinovea.Services
                     case "VideoFormat":
                         videoFormat = (KinoveaVideoFormat)Enum.Parse(typeof(KinoveaVideoFormat), reader.ReadElementContentAsString());
                         break;
+                    case "VideoEncodingProfile":
+                        videoEncodingProfile = (VideoEncodingProfile)Enum.Parse(typeof(VideoEncodingProfile), reader.ReadElementContentAsString());
+                        break;
+                    case "ExportEmbedKVA":
+                        exportEmbedKVA = XmlHelper.ParseBoolean(reader.ReadElementContentAsString());
+                        break;
                     case "Background":
                         backgroundColor = XmlHelper.ParseColor(reader.ReadElementContentAsString(), defaultBackgroundColor);
                         break;
@@ -51,6 +51,7 @@ namespace Kinovea.Services
             }
         }
         public static string TempDirectory { get; private set; }
+        public static string CacheDirectory { get; private set; }
         public static string CameraProfilesDirectory { get; private set; }
         public static string HelpVideosDirectory { get; private set; }
         public static string ManualsDirectory { get; private set; }
@@ -82,6 +83,7 @@ namespace Kinovea.Services
             ColorProfileDirectory = SettingsDirectory + "ColorProfiles\\";
             CameraCalibrationDirectory = SettingsDirectory + "CameraCalibration\\";
             TempDirectory = SettingsDirectory + "Temp\\";
+            CacheDirectory = SettingsDirectory + "Cache\\";
             CameraProfilesDirectory = Path.Combine(SettingsDirectory, "CameraProfiles");
             CameraPluginsDirectory = Path.Combine(SettingsDirectory, "Plugins", "Camera");
 
@@ -126,6 +128,7 @@ namespace Kinovea.Services
             CreateDirectory(CameraProfilesDirectory);
             CreateDirectory(CameraPluginsDirectory);
             CreateDirectory(TempDirectory);
+            CreateDirectory(CacheDirectory);
         }
 
         private static void CreateDirectory(string dir)
@@ -0,0 +1,36 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+
+namespace Kinovea.Services
+{
+    /// <summary>
+    /// Codec configuration used when exporting videos.
+    /// All profiles avoid B-frames so the decoding order is the display order and every frame can be reached exactly.
+    /// </summary>
+    public enum VideoEncodingProfile
+    {
+        /// <summary>
+        /// MPEG-4 part 2, every frame is a keyframe, minimum quantization.
+        /// Largest files but immediate access to any frame.
+        /// </summary>
+        Mpeg4Intra,
+
+        /// <summary>
+        /// Motion JPEG, every frame is a keyframe.
+        /// </summary>
+        MjpegIntra,
+
+        /// <summary>
+        /// H.264 (libx264), every frame is a keyframe, constant quality.
+        /// </summary>
+        H264Intra,
+
+        /// <summary>
+        /// H.264 (libx264), closed GOP of a few frames with a fixed keyframe interval, constant quality.
+        /// Much smaller files, reaching a frame decodes at most one short GOP.
+        /// </summary>
+        H264ShortGop
+    }
+}
@@ -0,0 +1,149 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Drawing;
+using System.Drawing.Imaging;
+using System.Runtime.InteropServices;
+using System.Diagnostics;
+using Kinovea.Services;
+using Kinovea.Video.FFMpeg;
+
+namespace Kinovea.Tests
+{
+    /// <summary>
+    /// Compare the vectorized pixel kernels against the scalar reference, and time both.
+    /// </summary>
+    public class PixelConversion
+    {
+        private static Random random = new Random();
+
+        public static void Test()
+        {
+            Console.WriteLine("Instruction set: {0}.", PixelConverter.InstructionSet);
+
+            // Odd sizes exercise the scalar tails of the vector loops.
+            Size[] sizes = new Size[] { new Size(2, 2), new Size(17, 9), new Size(641, 479), new Size(1920, 1080) };
+            foreach (Size size in sizes)
+            {
+                TestFill(size, Kinovea.Services.ImageFormat.RGB32, 4);
+                TestFill(size, Kinovea.Services.ImageFormat.Y800, 1);
+                TestBayer(size, Demosaicing.RGGB);
+                TestBayer(size, Demosaicing.GBRG);
+
+                foreach (ImageRotation rotation in Enum.GetValues(typeof(ImageRotation)))
+                {
+                    TestTransform(size, PixelFormat.Format24bppRgb, rotation, false);
+                    TestTransform(size, PixelFormat.Format24bppRgb, rotation, true);
+                    TestTransform(size, PixelFormat.Format32bppArgb, rotation, true);
+                }
+            }
+
+            Console.ReadKey();
+        }
+
+        private static void TestFill(Size size, Kinovea.Services.ImageFormat format, int depth)
+        {
+            byte[] buffer = CreateBuffer(size.Width * size.Height * depth);
+            Func<Bitmap> convert = () =>
+            {
+                Bitmap bitmap = new Bitmap(size.Width, size.Height, PixelFormat.Format24bppRgb);
+                PixelConverter.Fill(bitmap, buffer, format, false);
+                return bitmap;
+            };
+
+            Compare(string.Format("{0} {1}x{2}", format, size.Width, size.Height), convert);
+        }
+
+        private static void TestBayer(Size size, Demosaicing pattern)
+        {
+            byte[] buffer = CreateBuffer(size.Width * size.Height);
+            Func<Bitmap> convert = () =>
+            {
+                Bitmap bitmap = new Bitmap(size.Width, size.Height, PixelFormat.Format24bppRgb);
+                PixelConverter.FillFromBayer(bitmap, buffer, pattern, true);
+                return bitmap;
+            };
+
+            Compare(string.Format("Bayer {0} {1}x{2}", pattern, size.Width, size.Height), convert);
+        }
+
+        private static void TestTransform(Size size, PixelFormat pixelFormat, ImageRotation rotation, bool mirror)
+        {
+            Bitmap src = new Bitmap(size.Width, size.Height, pixelFormat);
+            BitmapData bmpData = src.LockBits(new Rectangle(Point.Empty, size), ImageLockMode.WriteOnly, pixelFormat);
+            byte[] bytes = CreateBuffer(bmpData.Stride * size.Height);
+            Marshal.Copy(bytes, 0, bmpData.Scan0, bytes.Length);
+            src.UnlockBits(bmpData);
+
+            Func<Bitmap> convert = () => PixelConverter.Transform(src, rotation, mirror);
+            Compare(string.Format("{0} {1}{2} {3}x{4}", pixelFormat, rotation, mirror ? " mirror" : "", size.Width, size.Height), convert);
+
+            src.Dispose();
+        }
+
+        /// <summary>
+        /// Run the conversion through the reference and the vector paths, check the images are identical and report the timings.
+        /// </summary>
+        private static void Compare(string name, Func<Bitmap> convert)
+        {
+            int loops = 20;
+
+            PixelConverter.UseReference = true;
+            Bitmap expected = convert();
+            double referenceMilliseconds = Time(convert, loops);
+
+            PixelConverter.UseReference = false;
+            Bitmap actual = convert();
+            double vectorMilliseconds = Time(convert, loops);
+
+            bool identical = AreEqual(expected, actual);
+            Console.WriteLine("{0}: {1}. Reference: {2:0.000} ms, vector: {3:0.000} ms.", name, identical ? "OK" : "FAILED", referenceMilliseconds, vectorMilliseconds);
+
+            expected.Dispose();
+            actual.Dispose();
+        }
+
+        private static double Time(Func<Bitmap> convert, int loops)
+        {
+            Stopwatch sw = Stopwatch.StartNew();
+            for (int i = 0; i < loops; i++)
+                convert().Dispose();
+
+            double elapsed = (double)sw.ElapsedTicks / Stopwatch.Frequency;
+            return (elapsed * 1000) / loops;
+        }
+
+        private static bool AreEqual(Bitmap a, Bitmap b)
+        {
+            if (a.Size != b.Size || a.PixelFormat != b.PixelFormat)
+                return false;
+
+            Rectangle rect = new Rectangle(Point.Empty, a.Size);
+            int rowBytes = a.Width * Image.GetPixelFormatSize(a.PixelFormat) / 8;
+            BitmapData dataA = a.LockBits(rect, ImageLockMode.ReadOnly, a.PixelFormat);
+            BitmapData dataB = b.LockBits(rect, ImageLockMode.ReadOnly, b.PixelFormat);
+            byte[] rowA = new byte[rowBytes];
+            byte[] rowB = new byte[rowBytes];
+
+            bool equal = true;
+            for (int y = 0; y < a.Height && equal; y++)
+            {
+                Marshal.Copy(dataA.Scan0 + y * dataA.Stride, rowA, 0, rowBytes);
+                Marshal.Copy(dataB.Scan0 + y * dataB.Stride, rowB, 0, rowBytes);
+                equal = rowA.SequenceEqual(rowB);
+            }
+
+            a.UnlockBits(dataA);
+            b.UnlockBits(dataB);
+            return equal;
+        }
+
+        private static byte[] CreateBuffer(int size)
+        {
+            byte[] buffer = new byte[size];
+            random.NextBytes(buffer);
+            return buffer;
+        }
+    }
+}
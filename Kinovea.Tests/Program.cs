@@ -21,6 +21,7 @@ namespace Kinovea.Tests
             
             // Performance
             //ImageCopy.Test();
+            //PixelConversion.Test();
         }
         private static void TestKVAFuzzer()
         {
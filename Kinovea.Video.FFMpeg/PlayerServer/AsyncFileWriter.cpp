@@ -0,0 +1,310 @@
+#pragma region License
+/*
+Copyright  Joan Charmant 2021.
+jcharmant@gmail.com
+
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#include <errno.h>
+#include <stdio.h>
+#include <msclr\lock.h>
+#include "AsyncFileWriter.h"
+
+using namespace msclr;
+using namespace Kinovea::Video::FFMpeg;
+
+// AVIOContext callbacks. The opaque pointer is a GCHandle to the writer.
+static int AsyncFileWriterWritePacket(void* opaque, uint8_t* buf, int buf_size)
+{
+    AsyncFileWriter^ writer = safe_cast<AsyncFileWriter^>(GCHandle::FromIntPtr(IntPtr(opaque)).Target);
+    return writer->Write(buf, buf_size);
+}
+
+static int64_t AsyncFileWriterSeek(void* opaque, int64_t offset, int whence)
+{
+    AsyncFileWriter^ writer = safe_cast<AsyncFileWriter^>(GCHandle::FromIntPtr(IntPtr(opaque)).Target);
+    return writer->Seek(offset, whence);
+}
+
+AsyncFileWriter::AsyncFileWriter()
+{
+    m_Locker = gcnew Object();
+    m_Stopwatch = gcnew Stopwatch();
+}
+
+AsyncFileWriter::~AsyncFileWriter()
+{
+    if (m_Thread != nullptr)
+        Close();
+
+    this->!AsyncFileWriter();
+}
+
+AsyncFileWriter::!AsyncFileWriter()
+{
+    FreeIOContext();
+}
+
+///<summary>
+/// Create the file and the IO context to hand to the muxer.
+/// Returns null if the file could not be created.
+///</summary>
+AVIOContext* AsyncFileWriter::Open(String^ _filePath)
+{
+    try
+    {
+        // The stream buffer is disabled, the chunks are the buffering.
+        m_Stream = gcnew FileStream(_filePath, FileMode::Create, FileAccess::Write, FileShare::Read, 1, FileOptions::None);
+    }
+    catch (Exception^ e)
+    {
+        log->Error("The output file could not be created.", e);
+        return nullptr;
+    }
+
+    m_Position = 0;
+    m_Length = 0;
+    m_Allocated = 0;
+    m_Failed = false;
+    m_Pending = 0;
+    ResetStats();
+
+    m_FreeChunks = gcnew BlockingCollection<Chunk^>();
+    m_WriteQueue = gcnew BlockingCollection<Chunk^>();
+    for (int i = 0; i < Chunks; i++)
+    {
+        Chunk^ chunk = gcnew Chunk();
+        chunk->data = gcnew array<System::Byte>(ChunkSize);
+        m_FreeChunks->Add(chunk);
+    }
+
+    m_Current = m_FreeChunks->Take();
+    m_Current->length = 0;
+
+    m_Stopwatch->Start();
+    m_Thread = gcnew Thread(gcnew ThreadStart(this, &AsyncFileWriter::WritingWorker));
+    m_Thread->IsBackground = true;
+    m_Thread->Name = "Record disk writer";
+    m_Thread->Start();
+
+    unsigned char* buffer = (unsigned char*)av_malloc(IOBufferSize);
+    m_Handle = GCHandle::Alloc(this);
+    m_IOContext = avio_alloc_context(buffer, IOBufferSize, 1, GCHandle::ToIntPtr(m_Handle).ToPointer(), nullptr, &AsyncFileWriterWritePacket, &AsyncFileWriterSeek);
+
+    return m_IOContext;
+}
+
+///<summary>
+/// Flush everything to disk, trim the preallocated space and close the file.
+/// The muxer must not use the IO context after this.
+///</summary>
+bool AsyncFileWriter::Close()
+{
+    if (m_Thread == nullptr)
+        return false;
+
+    if (m_IOContext != nullptr)
+        avio_flush(m_IOContext);
+
+    Drain();
+
+    m_WriteQueue->CompleteAdding();
+    m_Thread->Join();
+    m_Thread = nullptr;
+    m_Stopwatch->Stop();
+
+    try
+    {
+        m_Stream->SetLength(m_Length);
+        m_Stream->Close();
+    }
+    catch (Exception^ e)
+    {
+        log->Error("Error while closing the output file.", e);
+        m_Failed = true;
+    }
+
+    FreeIOContext();
+
+    log->DebugFormat("Output file closed. {0:0.00} MB written.", (double)m_Length / (1024 * 1024));
+
+    return !m_Failed;
+}
+
+void AsyncFileWriter::ResetStats()
+{
+    m_MaxPending = m_Pending;
+    m_Writes = 0;
+    m_WriteTicks = 0;
+    m_MaxWriteTicks = 0;
+}
+
+///<summary>
+/// Append the muxer output to the current chunk, hand full chunks to the disk thread.
+/// Only blocks when all the chunks are waiting for the disk.
+///</summary>
+int AsyncFileWriter::Write(uint8_t* _buffer, int _size)
+{
+    if (m_Failed)
+        return AVERROR(EIO);
+
+    int offset = 0;
+    while (offset < _size)
+    {
+        int count = Math::Min(_size - offset, ChunkSize - m_Current->length);
+        Marshal::Copy(IntPtr(_buffer + offset), m_Current->data, m_Current->length, count);
+        m_Current->length += count;
+        offset += count;
+
+        if (m_Current->length == ChunkSize)
+            Enqueue();
+    }
+
+    return _size;
+}
+
+///<summary>
+/// Muxers seek back to patch headers and indexes.
+/// This is rare so we simply wait for the disk thread to catch up and move the file pointer.
+///</summary>
+int64_t AsyncFileWriter::Seek(int64_t _offset, int _whence)
+{
+    _whence &= ~AVSEEK_FORCE;
+
+    if (_whence == AVSEEK_SIZE)
+        return Math::Max(m_Length, m_Position + m_Current->length);
+
+    if (!Drain())
+        return AVERROR(EIO);
+
+    int64_t target;
+    switch (_whence)
+    {
+    case SEEK_SET:
+        target = _offset;
+        break;
+    case SEEK_CUR:
+        target = m_Position + _offset;
+        break;
+    case SEEK_END:
+        target = m_Length + _offset;
+        break;
+    default:
+        return AVERROR(EINVAL);
+    }
+
+    try
+    {
+        m_Stream->Seek(target, SeekOrigin::Begin);
+    }
+    catch (Exception^ e)
+    {
+        log->Error("Error while seeking in the output file.", e);
+        return AVERROR(EIO);
+    }
+
+    m_Position = target;
+    return target;
+}
+
+void AsyncFileWriter::Enqueue()
+{
+    {
+        lock l(m_Locker);
+        m_Pending++;
+        m_MaxPending = Math::Max(m_MaxPending, m_Pending);
+    }
+
+    m_Position += m_Current->length;
+    m_WriteQueue->Add(m_Current);
+
+    m_Current = m_FreeChunks->Take();
+    m_Current->length = 0;
+}
+
+///<summary>
+/// Send the partial chunk and wait until everything is on disk.
+///</summary>
+bool AsyncFileWriter::Drain()
+{
+    if (m_Current->length > 0)
+        Enqueue();
+
+    lock l(m_Locker);
+    while (m_Pending > 0)
+        Monitor::Wait(m_Locker);
+
+    return !m_Failed;
+}
+
+///<summary>
+/// Disk thread. Writes the chunks in order and gives them back to the muxer side.
+///</summary>
+void AsyncFileWriter::WritingWorker()
+{
+    for each (Chunk^ chunk in m_WriteQueue->GetConsumingEnumerable())
+    {
+        // After a failure, keep draining the queue so the muxer is never blocked.
+        if (!m_Failed)
+        {
+            try
+            {
+                // Grow the file ahead of the data.
+                int64_t end = m_Stream->Position + chunk->length;
+                if (end > m_Allocated)
+                {
+                    m_Allocated = end + Extent;
+                    m_Stream->SetLength(m_Allocated);
+                }
+
+                int64_t then = m_Stopwatch->ElapsedTicks;
+                m_Stream->Write(chunk->data, 0, chunk->length);
+                int64_t ticks = m_Stopwatch->ElapsedTicks - then;
+
+                m_Writes++;
+                m_WriteTicks += ticks;
+                m_MaxWriteTicks = Math::Max(m_MaxWriteTicks, ticks);
+                m_Length = Math::Max(m_Length, m_Stream->Position);
+            }
+            catch (Exception^ e)
+            {
+                log->Error("Error while writing to the output file.", e);
+                m_Failed = true;
+            }
+        }
+
+        m_FreeChunks->Add(chunk);
+
+        lock l(m_Locker);
+        m_Pending--;
+        Monitor::PulseAll(m_Locker);
+    }
+}
+
+void AsyncFileWriter::FreeIOContext()
+{
+    if (m_IOContext != nullptr)
+    {
+        av_freep(&m_IOContext->buffer);
+        av_free(m_IOContext);
+        m_IOContext = nullptr;
+    }
+
+    if (m_Handle.IsAllocated)
+        m_Handle.Free();
+}
@@ -0,0 +1,132 @@
+#pragma region License
+/*
+Copyright  Joan Charmant 2021.
+jcharmant@gmail.com
+
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#pragma once
+
+extern "C" {
+#define __STDC_CONSTANT_MACROS
+#define __STDC_LIMIT_MACROS
+#include <avformat.h>
+}
+
+using namespace System;
+using namespace System::Collections::Concurrent;
+using namespace System::Diagnostics;
+using namespace System::IO;
+using namespace System::Reflection;
+using namespace System::Runtime::InteropServices;
+using namespace System::Threading;
+
+namespace Kinovea { namespace Video { namespace FFMpeg
+{
+    /// <summary>
+    /// Output file for the muxer, written from a dedicated thread.
+    /// The muxer output is coalesced into large fixed size chunks that rotate between the muxer and the disk thread,
+    /// so a slow write only stalls the recording once all the chunks are waiting for the disk.
+    /// The file is grown by large extents ahead of the data to limit fragmentation and metadata updates,
+    /// and trimmed to its actual size on close.
+    /// </summary>
+    public ref class AsyncFileWriter
+    {
+    public:
+        /// <summary>
+        /// Number of chunks waiting for the disk.
+        /// </summary>
+        property int QueueDepth {
+            int get() { return m_Pending; }
+        }
+        property int MaxQueueDepth {
+            int get() { return m_MaxPending; }
+        }
+        property int64_t Writes {
+            int64_t get() { return m_Writes; }
+        }
+        /// <summary>
+        /// Time spent in disk writes since the last reset, in stopwatch ticks.
+        /// </summary>
+        property int64_t WriteTicks {
+            int64_t get() { return m_WriteTicks; }
+        }
+        property int64_t MaxWriteTicks {
+            int64_t get() { return m_MaxWriteTicks; }
+        }
+
+    public:
+        AsyncFileWriter();
+        ~AsyncFileWriter();
+    protected:
+        !AsyncFileWriter();
+
+    public:
+        AVIOContext* Open(String^ _filePath);
+        bool Close();
+        void ResetStats();
+
+        int Write(uint8_t* _buffer, int _size);
+        int64_t Seek(int64_t _offset, int _whence);
+
+    private:
+        ref class Chunk
+        {
+        public:
+            array<System::Byte>^ data;
+            int length;
+        };
+
+        void Enqueue();
+        bool Drain();
+        void WritingWorker();
+        void FreeIOContext();
+
+    private:
+        FileStream^ m_Stream;
+        AVIOContext* m_IOContext;
+        GCHandle m_Handle;
+
+        Thread^ m_Thread;
+        BlockingCollection<Chunk^>^ m_FreeChunks;
+        BlockingCollection<Chunk^>^ m_WriteQueue;
+        Chunk^ m_Current;
+
+        // Position of the start of the current chunk in the file, and end of the data written so far.
+        int64_t m_Position;
+        int64_t m_Length;
+        int64_t m_Allocated;
+        bool m_Failed;
+
+        // Pending is shared with the disk thread under the locker, the stats are approximate.
+        int m_Pending;
+        int m_MaxPending;
+        int64_t m_Writes;
+        int64_t m_WriteTicks;
+        int64_t m_MaxWriteTicks;
+        Stopwatch^ m_Stopwatch;
+        Object^ m_Locker;
+
+        // 4 MB chunks keep the writes large and aligned on any sector or stripe size.
+        static const int ChunkSize = 4 * 1024 * 1024;
+        static const int Chunks = 3;
+        static const int IOBufferSize = 64 * 1024;
+        static const int64_t Extent = 256 * 1024 * 1024;
+        static log4net::ILog^ log = log4net::LogManager::GetLogger(MethodBase::GetCurrentMethod()->DeclaringType);
+    };
+}}}
@@ -0,0 +1,46 @@
+/*
+Copyright  Joan Charmant 2021.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+
+#pragma once
+
+using namespace System;
+
+namespace Kinovea { namespace Video { namespace FFMpeg
+{
+    /// <summary>
+    /// Reference to a decoded AVFrame whose data is wrapped directly by a Bitmap, without conversion.
+    /// Stored in the Tag of the Bitmap, the frame is freed when the Bitmap is disposed.
+    /// </summary>
+    private ref class DecodedFrameReference
+    {
+    public:
+        property IntPtr Frame {
+            IntPtr get() { return m_Frame; }
+        }
+
+        DecodedFrameReference(IntPtr _frame)
+        {
+            m_Frame = _frame;
+        }
+
+    private:
+        IntPtr m_Frame;
+    };
+}}}
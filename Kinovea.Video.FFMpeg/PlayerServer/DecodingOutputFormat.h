@@ -0,0 +1,36 @@
+/*
+Copyright  Joan Charmant 2021.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+
+#pragma once
+
+namespace Kinovea { namespace Video { namespace FFMpeg
+{
+    /// <summary>
+    /// Pixel format of the decoded frames.
+    /// Bgr24 and Gray8 are meant for analysis-only consumers that don't need the alpha channel or the colors,
+    /// they move less bytes per frame but are not supported by the rendering pipeline.
+    /// </summary>
+    public enum class DecodingOutputFormat
+    {
+        Bgra32,
+        Bgr24,
+        Gray8
+    };
+}}}
@@ -0,0 +1,37 @@
+/*
+Copyright  Joan Charmant 2021.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+
+#pragma once
+
+namespace Kinovea { namespace Video { namespace FFMpeg
+{
+    /// <summary>
+    /// Threading strategy used by the decoder.
+    /// Frame threading decodes several frames in parallel and adds one frame of delay per thread.
+    /// Slice threading decodes the slices of a single frame in parallel, it only works if the stream has several slices.
+    /// </summary>
+    public enum class DecodingThreading
+    {
+        Auto,
+        Disabled,
+        Frame,
+        Slice
+    };
+}}}
@@ -0,0 +1,148 @@
+#pragma region License
+/*
+Copyright  Joan Charmant 2021.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#include <msclr\lock.h>
+#include "FrameBufferPool.h"
+
+using namespace msclr;
+using namespace Kinovea::Video::FFMpeg;
+
+FrameBufferPool::FrameBufferPool()
+{
+    m_FreeBuffers = gcnew Dictionary<int, Stack<IntPtr>^>();
+    m_LeasedBuffers = gcnew Dictionary<IntPtr, int>();
+    m_Locker = gcnew Object();
+    m_PreferredSize = -1;
+}
+FrameBufferPool::~FrameBufferPool()
+{
+    this->!FrameBufferPool();
+}
+FrameBufferPool::!FrameBufferPool()
+{
+    Clear();
+}
+uint8_t* FrameBufferPool::Lease(int _size)
+{
+    if (_size <= 0)
+        return nullptr;
+
+    lock l(m_Locker);
+
+    m_Leases++;
+    m_PreferredSize = _size;
+
+    IntPtr buffer = IntPtr::Zero;
+    Stack<IntPtr>^ bucket = nullptr;
+    if (m_FreeBuffers->TryGetValue(_size, bucket) && bucket->Count > 0)
+    {
+        buffer = bucket->Pop();
+    }
+    else
+    {
+        m_Misses++;
+        uint8_t* pBuffer = (uint8_t*)av_malloc(_size);
+        if (pBuffer == nullptr)
+            return nullptr;
+
+        buffer = IntPtr((void*)pBuffer);
+        m_BytesResident += _size;
+    }
+
+    m_LeasedBuffers->Add(buffer, _size);
+    return (uint8_t*)buffer.ToPointer();
+}
+void FrameBufferPool::Return(uint8_t* _buffer)
+{
+    if (_buffer == nullptr)
+        return;
+
+    lock l(m_Locker);
+
+    IntPtr buffer = IntPtr((void*)_buffer);
+    int size;
+    if (!m_LeasedBuffers->TryGetValue(buffer, size))
+    {
+        log->Error("Trying to return a buffer that was not leased from the pool.");
+        return;
+    }
+
+    m_LeasedBuffers->Remove(buffer);
+
+    Stack<IntPtr>^ bucket = nullptr;
+    if (!m_FreeBuffers->TryGetValue(size, bucket))
+    {
+        bucket = gcnew Stack<IntPtr>();
+        m_FreeBuffers->Add(size, bucket);
+    }
+
+    if (size != m_PreferredSize || bucket->Count >= MaxFreeBuffersPerBucket)
+        FreeBuffer(buffer, size);
+    else
+        bucket->Push(buffer);
+}
+void FrameBufferPool::Trim(int _size)
+{
+    // Free all the idle buffers that are not of the passed size.
+    // Buffers of other sizes that are still in use will be freed when they are returned.
+    lock l(m_Locker);
+
+    m_PreferredSize = _size;
+
+    for each (KeyValuePair<int, Stack<IntPtr>^> pair in m_FreeBuffers)
+    {
+        if (pair.Key == _size)
+            continue;
+
+        while (pair.Value->Count > 0)
+            FreeBuffer(pair.Value->Pop(), pair.Key);
+    }
+}
+void FrameBufferPool::Clear()
+{
+    // Free all the idle buffers.
+    lock l(m_Locker);
+
+    for each (KeyValuePair<int, Stack<IntPtr>^> pair in m_FreeBuffers)
+    {
+        while (pair.Value->Count > 0)
+            FreeBuffer(pair.Value->Pop(), pair.Key);
+    }
+
+    m_FreeBuffers->Clear();
+    m_PreferredSize = -1;
+}
+void FrameBufferPool::ResetStats()
+{
+    m_Leases = 0;
+    m_Misses = 0;
+}
+String^ FrameBufferPool::GetStats()
+{
+    return String::Format("Leases: {0}, misses: {1}, resident: {2:0.0} MB ({3} in use).",
+        m_Leases, m_Misses, (double)m_BytesResident / (1024 * 1024), m_LeasedBuffers->Count);
+}
+void FrameBufferPool::FreeBuffer(IntPtr _buffer, int _size)
+{
+    av_free(_buffer.ToPointer());
+    m_BytesResident -= _size;
+}
@@ -0,0 +1,90 @@
+#pragma region License
+/*
+Copyright  Joan Charmant 2021.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#pragma once
+
+extern "C" {
+#define __STDC_CONSTANT_MACROS
+#define __STDC_LIMIT_MACROS
+#include <avutil.h>
+}
+
+using namespace System;
+using namespace System::Collections::Generic;
+using namespace System::Reflection;
+
+namespace Kinovea { namespace Video { namespace FFMpeg
+{
+    /// <summary>
+    /// A thread safe pool of native image buffers, bucketed by size.
+    /// Decoded frames lease a buffer from the pool and give it back when they are disposed,
+    /// this avoids a large allocation and deallocation for every decoded frame.
+    /// Buffers are allocated with av_malloc so they are aligned for SIMD routines.
+    /// </summary>
+    public ref class FrameBufferPool
+    {
+    public:
+        property int Leases {
+            int get() { return m_Leases; }
+        }
+        property int Misses {
+            int get() { return m_Misses; }
+        }
+        property int64_t BytesResident {
+            int64_t get() { return m_BytesResident; }
+        }
+
+    public:
+        FrameBufferPool();
+        ~FrameBufferPool();
+    protected:
+        !FrameBufferPool();
+
+    public:
+        uint8_t* Lease(int _size);
+        void Return(uint8_t* _buffer);
+        void Trim(int _size);
+        void Clear();
+        void ResetStats();
+        String^ GetStats();
+
+    private:
+        void FreeBuffer(IntPtr _buffer, int _size);
+
+    private:
+        // Free buffers, by size. The size of leased buffers is kept so they can be put back in the right bucket.
+        Dictionary<int, Stack<IntPtr>^>^ m_FreeBuffers;
+        Dictionary<IntPtr, int>^ m_LeasedBuffers;
+
+        // Size of the buffers currently in use by the reader. Returned buffers of any other size are freed.
+        int m_PreferredSize;
+
+        int m_Leases;
+        int m_Misses;
+        int64_t m_BytesResident;
+        Object^ m_Locker;
+
+        // Maximum number of free buffers kept per bucket. Should cover the prebuffer capacity.
+        static const int MaxFreeBuffersPerBucket = 32;
+        static log4net::ILog^ log = log4net::LogManager::GetLogger(MethodBase::GetCurrentMethod()->DeclaringType);
+    };
+}}}
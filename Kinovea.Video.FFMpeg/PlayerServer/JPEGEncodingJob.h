@@ -0,0 +1,66 @@
+/*
+Copyright  Joan Charmant 2008-2009.
+jcharmant@gmail.com
+
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+
+#pragma once
+
+using namespace System;
+using namespace System::Threading;
+
+namespace Kinovea { namespace Video { namespace FFMpeg
+{
+	/// <summary>
+	/// A frame travelling through the parallel encoders of the MJPEGWriter.
+	/// Jobs are allocated once per recording and recycled, the input image is copied in
+	/// so the caller can reuse its buffer as soon as the frame is queued.
+	/// </summary>
+	public ref class JPEGEncodingJob
+	{
+
+	public:
+
+		// Input
+		array<System::Byte>^ input;				// Copy of the incoming image.
+		Int64 length;
+		bool topDown;
+		Int64 timestamp;						// Capture time in microseconds, -1 if unknown.
+		AVPixelFormat inputFormat;
+		AVFrame* pInputFrame;					// Wraps the pinned input during conversion.
+
+		// Output
+		AVFrame* pYUV420Frame;					// Converted frame, wraps pYUV420Buffer.
+		uint8_t* pYUV420Buffer;
+		uint8_t* pEncodedBuffer;				// JPEG output buffer.
+		int iEncodedBufferSize;
+		int iEncodedSize;
+		bool success;
+
+		// Stats, in stopwatch ticks.
+		Int64 conversionTicks;
+		Int64 encodingTicks;
+
+		// Signaled by the encoder thread when the output is ready to be written.
+		ManualResetEventSlim^ done;
+
+		JPEGEncodingJob::JPEGEncodingJob()
+		{
+			done = gcnew ManualResetEventSlim(false);
+		}
+	};
+}}}
@@ -0,0 +1,253 @@
+#pragma region License
+/*
+Copyright  Joan Charmant 2021.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#include "KeyframeIndex.h"
+
+using namespace System::Runtime::InteropServices;
+using namespace System::Security::Cryptography;
+using namespace System::Text;
+using namespace Kinovea::Services;
+using namespace Kinovea::Video::FFMpeg;
+
+KeyframeIndex::KeyframeIndex()
+{
+    m_Timestamps = gcnew List<int64_t>();
+}
+int64_t KeyframeIndex::GetKeyframeBefore(int64_t _timestamp)
+{
+    // Returns the timestamp of the last keyframe at or before the passed timestamp, AV_NOPTS_VALUE if none.
+    int index = FindIndexBefore(_timestamp);
+    return index >= 0 ? m_Timestamps[index] : AV_NOPTS_VALUE;
+}
+int KeyframeIndex::FindIndexBefore(int64_t _timestamp)
+{
+    int index = m_Timestamps->BinarySearch(_timestamp);
+    if (index < 0)
+        index = ~index - 1;
+
+    return index;
+}
+KeyframeIndex^ KeyframeIndex::Build(String^ _filePath, int _streamIndex, ThreadCanceler^ _canceler)
+{
+    // Demux the whole file without decoding anything and collect the keyframes of the stream.
+    // This uses its own format context so it can run in the background while the reader is decoding.
+    AVFormatContext* pFormatCtx = nullptr;
+
+    // Libav expects the filename in the computer default codepage.
+    String^ encFilePath = Encoding::Default->GetString(Encoding::UTF8->GetBytes(_filePath));
+    char* pszFilePath = static_cast<char*>(Marshal::StringToHGlobalAnsi(encFilePath).ToPointer());
+    int openResult = avformat_open_input(&pFormatCtx, pszFilePath, NULL, NULL);
+    Marshal::FreeHGlobal(safe_cast<IntPtr>(pszFilePath));
+
+    if (openResult != 0)
+        return nullptr;
+
+    KeyframeIndex^ index = gcnew KeyframeIndex();
+    bool cancelled = false;
+    int64_t lastTimestamp = AV_NOPTS_VALUE;
+    bool sorted = true;
+
+    if (_streamIndex < 0 || _streamIndex >= (int)pFormatCtx->nb_streams)
+    {
+        cancelled = true;
+    }
+    else
+    {
+        // Discard all the other streams at the demuxer level.
+        for (int i = 0; i < (int)pFormatCtx->nb_streams; i++)
+            pFormatCtx->streams[i]->discard = i == _streamIndex ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+
+        AVPacket packet;
+        while (av_read_frame(pFormatCtx, &packet) >= 0)
+        {
+            if (packet.stream_index == _streamIndex && (packet.flags & AV_PKT_FLAG_KEY) != 0)
+            {
+                int64_t timestamp = packet.pts != AV_NOPTS_VALUE ? packet.pts : packet.dts;
+                if (timestamp != AV_NOPTS_VALUE)
+                {
+                    if (lastTimestamp != AV_NOPTS_VALUE && timestamp <= lastTimestamp)
+                        sorted = false;
+
+                    index->m_Timestamps->Add(timestamp);
+                    lastTimestamp = timestamp;
+                }
+            }
+
+            av_free_packet(&packet);
+
+            if (_canceler != nullptr && _canceler->CancellationPending)
+            {
+                cancelled = true;
+                break;
+            }
+        }
+    }
+
+    avformat_close_input(&pFormatCtx);
+
+    if (cancelled)
+        return nullptr;
+
+    if (!sorted)
+    {
+        // Should not happen for keyframes, but don't trust the binary search if it does.
+        log->Error("Keyframe timestamps are not monotonic, index discarded.");
+        return nullptr;
+    }
+
+    return index;
+}
+KeyframeIndex^ KeyframeIndex::Load(String^ _filePath, int _streamIndex)
+{
+    // Load the index from the cache if it exists and is still valid for the file.
+    String^ cacheFile = GetCacheFilePath(_filePath);
+    if (cacheFile == nullptr || !File::Exists(cacheFile))
+        return nullptr;
+
+    try
+    {
+        FileInfo^ fileInfo = gcnew FileInfo(_filePath);
+
+        KeyframeIndex^ index = gcnew KeyframeIndex();
+        FileStream^ fs = File::OpenRead(cacheFile);
+        BinaryReader^ br = gcnew BinaryReader(fs);
+        try
+        {
+            if (br->ReadInt32() != FormatVersion ||
+                br->ReadInt64() != fileInfo->Length ||
+                br->ReadInt64() != fileInfo->LastWriteTimeUtc.Ticks ||
+                br->ReadInt32() != _streamIndex)
+                return nullptr;
+
+            int count = br->ReadInt32();
+            index->m_Timestamps->Capacity = count;
+            for (int i = 0; i < count; i++)
+                index->m_Timestamps->Add(br->ReadInt64());
+        }
+        finally
+        {
+            br->Close();
+        }
+
+        // Mark the entry as recently used so it survives the cache trimming.
+        try
+        {
+            File::SetLastWriteTimeUtc(cacheFile, DateTime::UtcNow);
+        }
+        catch (IOException^)
+        {
+            // Not critical, the entry will just be trimmed earlier.
+        }
+
+        return index;
+    }
+    catch (Exception^ e)
+    {
+        log->ErrorFormat("Error while loading keyframe index. {0}", e->Message);
+        return nullptr;
+    }
+}
+void KeyframeIndex::Save(String^ _filePath, int _streamIndex)
+{
+    String^ cacheFile = GetCacheFilePath(_filePath);
+    if (cacheFile == nullptr)
+        return;
+
+    try
+    {
+        Directory::CreateDirectory(Path::GetDirectoryName(cacheFile));
+        FileInfo^ fileInfo = gcnew FileInfo(_filePath);
+
+        FileStream^ fs = File::Create(cacheFile);
+        BinaryWriter^ bw = gcnew BinaryWriter(fs);
+        try
+        {
+            bw->Write(FormatVersion);
+            bw->Write(fileInfo->Length);
+            bw->Write(fileInfo->LastWriteTimeUtc.Ticks);
+            bw->Write(_streamIndex);
+            bw->Write(m_Timestamps->Count);
+            for (int i = 0; i < m_Timestamps->Count; i++)
+                bw->Write(m_Timestamps[i]);
+        }
+        finally
+        {
+            bw->Close();
+        }
+
+        TrimCache(Path::GetDirectoryName(cacheFile));
+    }
+    catch (Exception^ e)
+    {
+        log->ErrorFormat("Error while saving keyframe index. {0}", e->Message);
+    }
+}
+String^ KeyframeIndex::GetCacheFilePath(String^ _filePath)
+{
+    // The cache file name is derived from the full path of the video.
+    // Size and modification date are stored inside the file to detect stale entries.
+    if (String::IsNullOrEmpty(Software::CacheDirectory))
+        return nullptr;
+
+    MD5^ md5 = MD5::Create();
+    array<Byte>^ hash = md5->ComputeHash(Encoding::UTF8->GetBytes(Path::GetFullPath(_filePath)->ToLowerInvariant()));
+    String^ name = BitConverter::ToString(hash)->Replace("-", "");
+    return Path::Combine(Path::Combine(Software::CacheDirectory, "KeyframeIndex"), name + ".kfi");
+}
+void KeyframeIndex::TrimCache(String^ _directory)
+{
+    // Delete the least recently used entries until the cache directory fits in its budget.
+    array<FileInfo^>^ files = (gcnew DirectoryInfo(_directory))->GetFiles("*.kfi");
+    int64_t total = 0;
+    for each (FileInfo^ file in files)
+        total += file->Length;
+
+    int64_t budget = (int64_t)MaxCacheSize * 1048576;
+    if (total <= budget)
+        return;
+
+    Array::Sort(files, gcnew Comparison<FileInfo^>(&KeyframeIndex::CompareLastWriteTime));
+    int deleted = 0;
+    for each (FileInfo^ file in files)
+    {
+        if (total <= budget)
+            break;
+
+        try
+        {
+            int64_t length = file->Length;
+            file->Delete();
+            total -= length;
+            deleted++;
+        }
+        catch (IOException^)
+        {
+            // The entry may be in use by another instance, try the next one.
+        }
+    }
+
+    log->DebugFormat("Keyframe index cache trimmed. {0} entries deleted.", deleted);
+}
+int KeyframeIndex::CompareLastWriteTime(FileInfo^ _a, FileInfo^ _b)
+{
+    return _a->LastWriteTimeUtc.CompareTo(_b->LastWriteTimeUtc);
+}
@@ -0,0 +1,74 @@
+#pragma region License
+/*
+Copyright  Joan Charmant 2021.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#pragma once
+
+extern "C" {
+#define __STDC_CONSTANT_MACROS
+#define __STDC_LIMIT_MACROS
+#include <avformat.h>
+#include <avcodec.h>
+}
+
+using namespace System;
+using namespace System::Collections::Generic;
+using namespace System::IO;
+using namespace System::Reflection;
+using namespace Kinovea::Video;
+
+namespace Kinovea { namespace Video { namespace FFMpeg
+{
+    /// <summary>
+    /// Timestamps of the keyframes of a video stream.
+    /// Built from a packet-only pass over the file (no decoding), and persisted in the application cache.
+    /// The cache directory is trimmed to its budget by removing the least recently used entries.
+    /// Timestamps are expressed in the stream time base, without the reader timestamp offset.
+    /// </summary>
+    public ref class KeyframeIndex
+    {
+    public:
+        property int Count {
+            int get() { return m_Timestamps->Count; }
+        }
+
+    public:
+        KeyframeIndex();
+        int64_t GetKeyframeBefore(int64_t _timestamp);
+
+        static KeyframeIndex^ Build(String^ _filePath, int _streamIndex, ThreadCanceler^ _canceler);
+        static KeyframeIndex^ Load(String^ _filePath, int _streamIndex);
+        void Save(String^ _filePath, int _streamIndex);
+
+    private:
+        int FindIndexBefore(int64_t _timestamp);
+        static String^ GetCacheFilePath(String^ _filePath);
+        static void TrimCache(String^ _directory);
+        static int CompareLastWriteTime(FileInfo^ _a, FileInfo^ _b);
+
+    private:
+        List<int64_t>^ m_Timestamps;
+
+        static const int FormatVersion = 2;
+        static const int MaxCacheSize = 32; // MB
+        static log4net::ILog^ log = log4net::LogManager::GetLogger(MethodBase::GetCurrentMethod()->DeclaringType);
+    };
+}}}
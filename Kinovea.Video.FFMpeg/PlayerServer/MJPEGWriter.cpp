@@ -34,7 +34,7 @@ MJPEGWriter::MJPEGWriter()
     av_register_all();
     m_swEncoding = gcnew Stopwatch();
     m_swWrite = gcnew Stopwatch();
-
+    m_encoderThreads = 1;
 }
 MJPEGWriter::~MJPEGWriter()
 {
@@ -78,6 +78,9 @@ SaveResult MJPEGWriter::OpenSavingContext(String^ _filePath, VideoInfo _info, St
 
     if(_fFileFramesInterval > 0) 
         m_SavingContext->fFramesInterval = _fFileFramesInterval;
+
+    if (_fFramesInterval > 0 && _fFileFramesInterval > 0)
+        m_SavingContext->fTimestampScale = _fFileFramesInterval / _fFramesInterval;
     
     m_SavingContext->iBitrate = (int)ComputeBitrate(m_SavingContext->outputSize, m_SavingContext->fFramesInterval);
     
@@ -179,14 +182,19 @@ SaveResult MJPEGWriter::OpenSavingContext(String^ _filePath, VideoInfo _info, St
 
         
         // 9. Open the file.
-        averror = avio_open(&(m_SavingContext->pOutputFormatContext)->pb, m_SavingContext->pFilePath, AVIO_FLAG_WRITE);
-        if (averror < 0) 
+        // The muxer writes through our own IO context so disk latency doesn't stall the recording thread.
+        m_fileWriter = gcnew AsyncFileWriter();
+        AVIOContext* pIOContext = m_fileWriter->Open(_filePath);
+        if (pIOContext == nullptr) 
         {
             result = SaveResult::FileNotOpened;
-            LogError("File not opened", averror);
+            log->Error("File not opened");
             break;
         }
 
+        m_SavingContext->pOutputFormatContext->pb = pIOContext;
+        m_SavingContext->pOutputFormatContext->flags |= AVFMT_FLAG_CUSTOM_IO;
+
         SanityCheck(m_SavingContext->pOutputFormatContext);
 
         // 10. Write file header.
@@ -223,6 +231,34 @@ SaveResult MJPEGWriter::OpenSavingContext(String^ _filePath, VideoInfo _info, St
             NULL, NULL, NULL);
 
         m_SavingContext->pScalingContext = scalingContext;
+
+        // 13. Allocate the conversion and encoding buffers, reused for every frame.
+        Int64 then = m_swEncoding->ElapsedTicks;
+        if (!AllocateFrameBuffers(m_SavingContext))
+        {
+            result = SaveResult::InputFrameNotAllocated;
+            log->Error("Frame buffers not allocated");
+            break;
+        }
+        
+        log->DebugFormat("Frame buffers allocated in {0:0.000} ms.", TicksToMilliseconds(m_swEncoding->ElapsedTicks - then));
+
+        // 14. Start the parallel encoders.
+        // Only worth it when there is actual compression work, JPEG input and uncompressed output are a simple copy.
+        int threads = m_encoderThreads > 0 ? m_encoderThreads : Math::Min(Environment::ProcessorCount - 1, 4);
+        if (threads > 1 && !_uncompressed && _imageFormat != Kinovea::Services::ImageFormat::JPEG)
+        {
+            if (StartEncoderThreads(m_SavingContext, srcFormat, threads))
+            {
+                log->DebugFormat("Parallel encoding with {0} threads, up to {1} frames in flight.", threads, m_inFlightCapacity);
+            }
+            else
+            {
+                log->Error("Parallel encoders not started, encoding on the recording thread.");
+                StopEncoderThreads();
+                FreeEncoderThreads(m_SavingContext);
+            }
+        }
     }
     while(false);
 
@@ -274,6 +310,11 @@ SaveResult MJPEGWriter::CloseSavingContext(bool _bEncodingSuccess)
     log->Debug("Closing the saving context.");
 
     SaveResult result = SaveResult::Success;
+    
+    // Flush the frames still in flight before the trailer.
+    StopEncoderThreads();
+    FreeEncoderThreads(m_SavingContext);
+    
     m_swEncoding->Stop();
     m_swWrite->Stop();
 
@@ -299,7 +340,15 @@ SaveResult MJPEGWriter::CloseSavingContext(bool _bEncodingSuccess)
     }
 
     // Close file.
-    avio_close(m_SavingContext->pOutputFormatContext->pb);
+    if (m_fileWriter != nullptr)
+    {
+        if (!m_fileWriter->Close())
+            result = SaveResult::UnknownError;
+        
+        delete m_fileWriter;
+        m_fileWriter = nullptr;
+        m_SavingContext->pOutputFormatContext->pb = nullptr;
+    }
 
     // Release muxer parameter object.
     av_free(m_SavingContext->pOutputFormatContext);
@@ -309,7 +358,8 @@ SaveResult MJPEGWriter::CloseSavingContext(bool _bEncodingSuccess)
     // Release scaling context
     sws_freeContext(m_SavingContext->pScalingContext);
 
-    // Release input frame buffer.
+    // Release conversion and encoding buffers.
+    FreeFrameBuffers(m_SavingContext);
 
     log->Debug("Saving video completed.");
 
@@ -317,11 +367,32 @@ SaveResult MJPEGWriter::CloseSavingContext(bool _bEncodingSuccess)
 }
 
 SaveResult MJPEGWriter::SaveFrame(Kinovea::Services::ImageFormat format, array<System::Byte>^ buffer, Int64 length, bool topDown)
+{
+    return SaveFrame(format, buffer, length, topDown, -1);
+}
+
+///<summary>
+/// Save a frame with its capture time, in microseconds.
+/// The timestamps are written as is (scaled for slow motion), so drops show up as gaps in the file.
+///</summary>
+SaveResult MJPEGWriter::SaveFrame(Kinovea::Services::ImageFormat format, array<System::Byte>^ buffer, Int64 length, bool topDown, Int64 timestamp)
 {
     SaveResult result = SaveResult::Success;
     bool saved = false;
 
+    if (m_muxer != nullptr)
+    {
+        if (!QueueFrame(format, buffer, length, topDown, timestamp))
+        {
+            log->Error("error while queuing output frame");
+            result = SaveResult::UnknownError;
+        }
+
+        return result;
+    }
+
     m_frame++;
+    m_SavingContext->iCurrentTimestamp = timestamp;
 
     switch (format)
     {
@@ -552,310 +623,438 @@ bool MJPEGWriter::SetupEncoder(SavingContext^ _SavingContext, Kinovea::Services:
     return true;
 }
 
+///<summary>
+/// Allocate the YUV420P frame and the JPEG buffer once for the whole recording.
+///</summary>
+bool MJPEGWriter::AllocateFrameBuffers(SavingContext^ _SavingContext)
+{
+    int width = _SavingContext->outputSize.Width;
+    int height = _SavingContext->outputSize.Height;
+
+    if ((_SavingContext->pYUV420Frame = av_frame_alloc()) == nullptr) 
+    {
+        log->Error("YUV420P frame not allocated");
+        return false;
+    }
+
+    _SavingContext->iYUV420BufferSize = avpicture_get_size(AV_PIX_FMT_YUV420P, width, height);
+    _SavingContext->pYUV420Buffer = (uint8_t*)av_malloc(_SavingContext->iYUV420BufferSize);
+    if (_SavingContext->pYUV420Buffer == nullptr) 
+    {
+        log->Error("YUV frame buffer not allocated");
+        return false;
+    }
+    
+    avpicture_fill((AVPicture*)_SavingContext->pYUV420Frame, _SavingContext->pYUV420Buffer, AV_PIX_FMT_YUV420P, width, height);
+
+    if (!_SavingContext->uncompressed)
+    {
+        // Assumes uncompressed size is always smaller than compressed. (Not technically true).
+        _SavingContext->iEncodedBufferSize = FFMAX(_SavingContext->iYUV420BufferSize, FF_MIN_BUFFER_SIZE);
+        _SavingContext->pEncodedBuffer = (uint8_t*)av_malloc(_SavingContext->iEncodedBufferSize);
+        if (_SavingContext->pEncodedBuffer == nullptr)
+        {
+            log->Error("output video buffer not allocated");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void MJPEGWriter::FreeFrameBuffers(SavingContext^ _SavingContext)
+{
+    if (_SavingContext->pYUV420Frame != nullptr)
+    {
+        av_free(_SavingContext->pYUV420Frame);
+        _SavingContext->pYUV420Frame = nullptr;
+    }
+
+    if (_SavingContext->pYUV420Buffer != nullptr)
+    {
+        av_free(_SavingContext->pYUV420Buffer);
+        _SavingContext->pYUV420Buffer = nullptr;
+    }
+
+    if (_SavingContext->pEncodedBuffer != nullptr)
+    {
+        av_free(_SavingContext->pEncodedBuffer);
+        _SavingContext->pEncodedBuffer = nullptr;
+    }
+}
+
 ///<summary>
 /// Encode an RGB32 image into a JPEG and push it to the file.
 ///</summary>
 bool MJPEGWriter::EncodeAndWriteVideoFrameRGB32(SavingContext^ _SavingContext, array<System::Byte>^ managedBuffer, Int64 length, bool topDown)
 {
-    bool written = false;
-    AVFrame* pYUV420Frame = nullptr;
-    uint8_t* pYUV420Buffer = nullptr;
-    uint8_t* pJpegBuffer = nullptr;
+    Int64 then = m_swEncoding->ElapsedTicks;
+    pin_ptr<uint8_t> pRGB32Buffer = &managedBuffer[0];
+    return ConvertEncodeAndWrite(_SavingContext, pRGB32Buffer, AV_PIX_FMT_BGRA, topDown, then);
+}
+
+///<summary>
+/// Encode an RGB24 image into a JPEG and push it to the file.
+///</summary>
+bool MJPEGWriter::EncodeAndWriteVideoFrameRGB24(SavingContext^ _SavingContext, array<System::Byte>^ managedBuffer, Int64 length, bool topDown)
+{
+    Int64 then = m_swEncoding->ElapsedTicks;
+    pin_ptr<uint8_t> pRGB24Buffer = &managedBuffer[0];
+    return ConvertEncodeAndWrite(_SavingContext, pRGB24Buffer, AV_PIX_FMT_BGR24, topDown, then);
+}
+
+///<summary>
+/// Encode a monochrome 8 image into a JPEG and push it to the file.
+///</summary>
+bool MJPEGWriter::EncodeAndWriteVideoFrameY800(SavingContext^ _SavingContext, array<System::Byte>^ managedBuffer, Int64 length, bool topDown)
+{
+    Int64 then = m_swEncoding->ElapsedTicks;
+    pin_ptr<uint8_t> pInputBuffer = &managedBuffer[0];
     
-    do
+    if (!_SavingContext->uncompressed)
     {
-        Int64 then = m_swEncoding->ElapsedMilliseconds;
+        // Unfortunately the MJPEG encoder doesn't know how to work directly with Y800/GRAY8 images.
+        // Instead of directly pushing the buffer to the AVFrame we need to use an intermediate YUV420p frame.
+        return ConvertEncodeAndWrite(_SavingContext, pInputBuffer, AV_PIX_FMT_GRAY8, topDown, then);
+    }
 
-        int width = _SavingContext->outputSize.Width;
-        int height = _SavingContext->outputSize.Height;
-        
-        pin_ptr<uint8_t> pRGB32Buffer = &managedBuffer[0];
-        avpicture_fill((AVPicture*)_SavingContext->pInputFrame, pRGB32Buffer, AV_PIX_FMT_BGRA, width, height);
-        
-        // Alter planes and stride to vertically flip image during conversion.
-        if (!topDown)
-        {
-          _SavingContext->pInputFrame->data[0] += _SavingContext->pInputFrame->linesize[0] * (height - 1);
-          _SavingContext->pInputFrame->linesize[0] = -_SavingContext->pInputFrame->linesize[0];
-        }
+    // Special shortcut for uncompressed Y800. 
+    // The preallocated YUV420P buffer is larger than a single gray plane.
+    int width = _SavingContext->outputSize.Width;
+    int height = _SavingContext->outputSize.Height;
+    uint8_t* pOutputBuffer = _SavingContext->pYUV420Buffer;
+    if (length > _SavingContext->iYUV420BufferSize)
+    {
+        log->Error("Y800 frame larger than the preallocated buffer");
+        return false;
+    }
 
-        // Prepare the color space converted frame.
-        if ((pYUV420Frame = av_frame_alloc()) == nullptr) 
-        {
-            log->Error("YUV420P frame not allocated");
-            break;
-        }
+    Interlocked::Add(m_setupDurationAccumulator, m_swEncoding->ElapsedTicks - then);
+    then = m_swEncoding->ElapsedTicks;
 
-        int yuvBufferSize = avpicture_get_size(AV_PIX_FMT_YUV420P, width, height);
-        pYUV420Buffer = (uint8_t*)av_malloc(yuvBufferSize);
-        if (pYUV420Buffer == nullptr) 
-        {
-            log->Error("YUV frame buffer not allocated");
-            break;
-        }
-        
-        avpicture_fill((AVPicture*)pYUV420Frame, pYUV420Buffer, AV_PIX_FMT_YUV420P, width, height);
-        
-        // Perform the color space conversion.
-        if (sws_scale(_SavingContext->pScalingContext, _SavingContext->pInputFrame->data, _SavingContext->pInputFrame->linesize, 0, height, pYUV420Frame->data, pYUV420Frame->linesize) < 0) 
+    if (topDown)
+    {
+        memcpy(pOutputBuffer, pInputBuffer, length);
+    }
+    else
+    {
+        for (int i = 0; i < height; i++)
         {
-            log->Error("Color conversion failed");
-            break;
+            uint8_t* pDst = pOutputBuffer + i * width;
+            uint8_t* pSrc = pInputBuffer + ((height - 1 - i) * width);
+            memcpy(pDst, pSrc, width);
         }
-        
-        int encodedSize = yuvBufferSize;
-        if (!_SavingContext->uncompressed)
-        {
-            // Allocated JPEG frame buffer. 
-            // Assumes uncompressed size is always smaller than compressed. (Not technically true).
-            int jpegBufferSize = yuvBufferSize;
-            pJpegBuffer = (uint8_t*)av_malloc(jpegBufferSize);
-            if (pJpegBuffer == nullptr)
-            {
-                log->Error("output video buffer not allocated");
-                break;
-            }
+    }
 
-            // Actual encoding step.
-            encodedSize = avcodec_encode_video(_SavingContext->pOutputCodecContext, pJpegBuffer, jpegBufferSize, pYUV420Frame);
-        }
+    Interlocked::Add(m_conversionDurationAccumulator, m_swEncoding->ElapsedTicks - then);
 
-        m_encodingDurationAccumulator += (m_swEncoding->ElapsedMilliseconds - then);
-        
-        if (encodedSize <= 0)
-            break;
+    WriteBuffer((int)length, _SavingContext, pOutputBuffer, true);
+    return true;
+}
 
-        if (_SavingContext->uncompressed)
-            WriteBuffer(encodedSize, _SavingContext, pYUV420Buffer, true);
-        else
-            WriteBuffer(encodedSize, _SavingContext, pJpegBuffer, true);
-        
-        written = true;
+///<summary>
+/// Convert the input image to YUV420P, encode it to JPEG unless recording uncompressed, and push it to the file.
+/// Only uses the buffers of the saving context, nothing is allocated per frame.
+///</summary>
+bool MJPEGWriter::ConvertEncodeAndWrite(SavingContext^ _SavingContext, uint8_t* _pInputBuffer, AVPixelFormat _inputFormat, bool _topDown, Int64 _then)
+{
+    Int64 then = m_swEncoding->ElapsedTicks;
+    Interlocked::Add(m_setupDurationAccumulator, then - _then);
+    
+    AVFrame* pYUV420Frame = _SavingContext->pYUV420Frame;
+    if (!ConvertToYUV420(_SavingContext->pScalingContext, _SavingContext->pInputFrame, _pInputBuffer, _inputFormat, _topDown, pYUV420Frame, _SavingContext->outputSize))
+    {
+        log->Error("Color conversion failed");
+        return false;
     }
-    while(false);
 
-    if (pJpegBuffer != nullptr)
-        av_free(pJpegBuffer);
+    Int64 now = m_swEncoding->ElapsedTicks;
+    Interlocked::Add(m_conversionDurationAccumulator, now - then);
+    then = now;
+    
+    if (_SavingContext->uncompressed)
+    {
+        WriteBuffer(_SavingContext->iYUV420BufferSize, _SavingContext, _SavingContext->pYUV420Buffer, true);
+        return true;
+    }
 
-    if (pYUV420Frame != nullptr)
-        av_free(pYUV420Frame);
+    // Actual encoding step.
+    int encodedSize = avcodec_encode_video(_SavingContext->pOutputCodecContext, _SavingContext->pEncodedBuffer, _SavingContext->iEncodedBufferSize, pYUV420Frame);
+    
+    Interlocked::Add(m_encodingDurationAccumulator, m_swEncoding->ElapsedTicks - then);
 
-    if (pYUV420Buffer != nullptr)
-        av_free(pYUV420Buffer);
+    if (encodedSize <= 0)
+        return false;
 
-    return written;
+    WriteBuffer(encodedSize, _SavingContext, _SavingContext->pEncodedBuffer, true);
+    return true;
 }
 
+///<summary>
+/// Wrap the input buffer in the input frame and convert it to YUV420P.
+///</summary>
+bool MJPEGWriter::ConvertToYUV420(SwsContext* _pScalingContext, AVFrame* _pInputFrame, uint8_t* _pInputBuffer, AVPixelFormat _inputFormat, bool _topDown, AVFrame* _pYUV420Frame, Size _size)
+{
+    int width = _size.Width;
+    int height = _size.Height;
+    
+    avpicture_fill((AVPicture*)_pInputFrame, _pInputBuffer, _inputFormat, width, height);
+    
+    // Alter planes and stride to vertically flip image during conversion.
+    if (!_topDown)
+    {
+      _pInputFrame->data[0] += _pInputFrame->linesize[0] * (height - 1);
+      _pInputFrame->linesize[0] = -_pInputFrame->linesize[0];
+    }
+
+    // Perform the color space conversion.
+    return sws_scale(_pScalingContext, _pInputFrame->data, _pInputFrame->linesize, 0, height, _pYUV420Frame->data, _pYUV420Frame->linesize) >= 0;
+}
 
 ///<summary>
-/// Encode an RGB24 image into a JPEG and push it to the file.
+/// Set up the parallel encoding mode.
+/// Each encoding thread owns a JPEG encoder and a color conversion context, the jobs own the input copy and the output buffers.
+/// The muxer thread writes the jobs in the order they were queued, whichever encoder finishes first.
 ///</summary>
-bool MJPEGWriter::EncodeAndWriteVideoFrameRGB24(SavingContext^ _SavingContext, array<System::Byte>^ managedBuffer, Int64 length, bool topDown)
+bool MJPEGWriter::StartEncoderThreads(SavingContext^ _SavingContext, AVPixelFormat _inputFormat, int _threads)
 {
-    bool written = false;
-    AVFrame* pYUV420Frame = nullptr;
-    uint8_t* pYUV420Buffer = nullptr;
-    uint8_t* pJpegBuffer = nullptr;
+    int width = _SavingContext->outputSize.Width;
+    int height = _SavingContext->outputSize.Height;
     
-    do
+    _SavingContext->encoderCodecContexts = gcnew array<IntPtr>(_threads);
+    _SavingContext->encoderScalingContexts = gcnew array<IntPtr>(_threads);
+    for (int i = 0; i < _threads; i++)
     {
-        Int64 then = m_swEncoding->ElapsedMilliseconds;
+        AVCodecContext* pCodecContext = avcodec_alloc_context3(_SavingContext->pOutputCodec);
+        if (pCodecContext == nullptr)
+            return false;
 
-        int width = _SavingContext->outputSize.Width;
-        int height = _SavingContext->outputSize.Height;
+        _SavingContext->encoderCodecContexts[i] = IntPtr(pCodecContext);
         
-        pin_ptr<uint8_t> pRGB24Buffer = &managedBuffer[0];
-        avpicture_fill((AVPicture*)_SavingContext->pInputFrame, pRGB24Buffer, AV_PIX_FMT_BGR24, width, height);
+        int averror = avcodec_copy_context(pCodecContext, _SavingContext->pOutputCodecContext);
+        if (averror >= 0)
+            averror = avcodec_open2(pCodecContext, _SavingContext->pOutputCodec, nullptr);
         
-        // Alter planes and stride to vertically flip image during conversion.
-        if (!topDown)
-        {
-          _SavingContext->pInputFrame->data[0] += _SavingContext->pInputFrame->linesize[0] * (height - 1);
-          _SavingContext->pInputFrame->linesize[0] = -_SavingContext->pInputFrame->linesize[0];
-        }
-
-        // Prepare the color space converted frame.
-        if ((pYUV420Frame = av_frame_alloc()) == nullptr) 
+        if (averror < 0)
         {
-            log->Error("YUV420P frame not allocated");
-            break;
+            LogError("Parallel encoder not opened", averror);
+            return false;
         }
 
-        int yuvBufferSize = avpicture_get_size(AV_PIX_FMT_YUV420P, width, height);
-        pYUV420Buffer = (uint8_t*)av_malloc(yuvBufferSize);
-        if (pYUV420Buffer == nullptr) 
-        {
-            log->Error("YUV frame buffer not allocated");
-            break;
-        }
-        
-        avpicture_fill((AVPicture*)pYUV420Frame, pYUV420Buffer, AV_PIX_FMT_YUV420P, width, height);
+        SwsContext* pScalingContext = sws_getContext(width, height, _inputFormat, width, height, AV_PIX_FMT_YUV420P, SWS_POINT, NULL, NULL, NULL);
+        if (pScalingContext == nullptr)
+            return false;
         
-        // Perform the color space conversion.
-        if (sws_scale(_SavingContext->pScalingContext, _SavingContext->pInputFrame->data, _SavingContext->pInputFrame->linesize, 0, height, pYUV420Frame->data, pYUV420Frame->linesize) < 0) 
-        {
-            log->Error("Color conversion failed");
-            break;
-        }
+        _SavingContext->encoderScalingContexts[i] = IntPtr(pScalingContext);
+    }
 
-        int encodedSize = yuvBufferSize;
-        if (!_SavingContext->uncompressed)
-        {
-            // Allocated JPEG frame buffer. 
-            // Assumes uncompressed size is always smaller than compressed. (Not technically true).
-            int jpegBufferSize = yuvBufferSize;
-            pJpegBuffer = (uint8_t*)av_malloc(jpegBufferSize);
-            if (pJpegBuffer == nullptr) 
-            {
-                log->Error("output video buffer not allocated");
-                break;
-            }
+    // Twice as many jobs as encoders so the encoders are not starved while the muxer writes.
+    // This is the number of frames the writer can absorb before SaveFrame blocks the caller.
+    int capacity = _threads * 2;
+    int yuvSize = avpicture_get_size(AV_PIX_FMT_YUV420P, width, height);
+    m_jobs = gcnew array<JPEGEncodingJob^>(capacity);
+    m_freeJobs = gcnew BlockingCollection<JPEGEncodingJob^>();
+    for (int i = 0; i < capacity; i++)
+    {
+        JPEGEncodingJob^ job = gcnew JPEGEncodingJob();
+        m_jobs[i] = job;
         
-            // Actual encoding step.
-            encodedSize = avcodec_encode_video(_SavingContext->pOutputCodecContext, pJpegBuffer, jpegBufferSize, pYUV420Frame);
-        }
+        job->pInputFrame = av_frame_alloc();
+        job->pYUV420Frame = av_frame_alloc();
+        job->pYUV420Buffer = (uint8_t*)av_malloc(yuvSize);
+        job->iEncodedBufferSize = FFMAX(yuvSize, FF_MIN_BUFFER_SIZE);
+        job->pEncodedBuffer = (uint8_t*)av_malloc(job->iEncodedBufferSize);
+        if (job->pInputFrame == nullptr || job->pYUV420Frame == nullptr || job->pYUV420Buffer == nullptr || job->pEncodedBuffer == nullptr)
+            return false;
+
+        avpicture_fill((AVPicture*)job->pYUV420Frame, job->pYUV420Buffer, AV_PIX_FMT_YUV420P, width, height);
+        m_freeJobs->Add(job);
+    }
 
-        m_encodingDurationAccumulator += (m_swEncoding->ElapsedMilliseconds - then);
+    m_encodingQueue = gcnew BlockingCollection<JPEGEncodingJob^>();
+    m_muxingQueue = gcnew BlockingCollection<JPEGEncodingJob^>();
+    m_encodingFailed = false;
+    m_inFlight = 0;
+    
+    m_encoders = gcnew array<Thread^>(_threads);
+    for (int i = 0; i < _threads; i++)
+    {
+        m_encoders[i] = gcnew Thread(gcnew ParameterizedThreadStart(this, &MJPEGWriter::EncoderWorker));
+        m_encoders[i]->IsBackground = true;
+        m_encoders[i]->Name = String::Format("Record encoding {0}", i);
+        m_encoders[i]->Start(i);
+    }
+    
+    m_muxer = gcnew Thread(gcnew ThreadStart(this, &MJPEGWriter::MuxerWorker));
+    m_muxer->IsBackground = true;
+    m_muxer->Name = "Record muxing";
+    m_muxer->Start();
 
-        if (encodedSize <= 0)
-            break;
+    m_inFlightCapacity = capacity;
+    return true;
+}
 
-        if (_SavingContext->uncompressed)
-            WriteBuffer(encodedSize, _SavingContext, pYUV420Buffer, true);
-        else
-            WriteBuffer(encodedSize, _SavingContext, pJpegBuffer, true);
+///<summary>
+/// Wait for the queued frames to be written and terminate the encoding and muxing threads.
+///</summary>
+void MJPEGWriter::StopEncoderThreads()
+{
+    if (m_muxer == nullptr)
+        return;
 
-        written = true;
+    m_encodingQueue->CompleteAdding();
+    m_muxingQueue->CompleteAdding();
+    
+    for each (Thread^ encoder in m_encoders)
+        encoder->Join();
+    
+    m_muxer->Join();
+    
+    m_encoders = nullptr;
+    m_muxer = nullptr;
+    m_inFlightCapacity = 0;
+}
+
+void MJPEGWriter::FreeEncoderThreads(SavingContext^ _SavingContext)
+{
+    if (m_jobs != nullptr)
+    {
+        for each (JPEGEncodingJob^ job in m_jobs)
+        {
+            if (job == nullptr)
+                continue;
+
+            av_free(job->pInputFrame);
+            av_free(job->pYUV420Frame);
+            av_free(job->pYUV420Buffer);
+            av_free(job->pEncodedBuffer);
+        }
+
+        m_jobs = nullptr;
     }
-    while(false);
+    
+    if (_SavingContext->encoderCodecContexts != nullptr)
+    {
+        for each (IntPtr p in _SavingContext->encoderCodecContexts)
+        {
+            if (p == IntPtr::Zero)
+                continue;
 
-    if (pJpegBuffer != nullptr)
-        av_free(pJpegBuffer);
+            AVCodecContext* pCodecContext = (AVCodecContext*)p.ToPointer();
+            avcodec_close(pCodecContext);
+            av_free(pCodecContext);
+        }
 
-    if (pYUV420Frame != nullptr)
-        av_free(pYUV420Frame);
+        _SavingContext->encoderCodecContexts = nullptr;
+    }
 
-    if (pYUV420Buffer != nullptr)
-        av_free(pYUV420Buffer);
+    if (_SavingContext->encoderScalingContexts != nullptr)
+    {
+        for each (IntPtr p in _SavingContext->encoderScalingContexts)
+            sws_freeContext((SwsContext*)p.ToPointer());
 
-    return written;
+        _SavingContext->encoderScalingContexts = nullptr;
+    }
 }
 
-
 ///<summary>
-/// Encode a monochrome 8 image into a JPEG and push it to the file.
+/// Copy the frame into a free job and hand it to the encoders.
+/// Blocks when all the jobs are in flight, so a sustained overload still shows up as drops in the pipeline.
 ///</summary>
-bool MJPEGWriter::EncodeAndWriteVideoFrameY800(SavingContext^ _SavingContext, array<System::Byte>^ managedBuffer, Int64 length, bool topDown)
+bool MJPEGWriter::QueueFrame(Kinovea::Services::ImageFormat _format, array<System::Byte>^ _buffer, Int64 _length, bool _topDown, Int64 _timestamp)
 {
-    bool written = false;
-    AVFrame* pYUV420Frame = nullptr;
-    uint8_t* pYUV420Buffer = nullptr;
-    uint8_t* pJpegBuffer = nullptr;
+    if (m_encodingFailed)
+        return false;
     
-    do
-    {
-        Int64 then = m_swEncoding->ElapsedMilliseconds;
-
-        int width = _SavingContext->outputSize.Width;
-        int height = _SavingContext->outputSize.Height;
-
-        pin_ptr<uint8_t> pInputBuffer = &managedBuffer[0];
-        
-        if (_SavingContext->uncompressed)
-        {
-            // Special shortcut for uncompressed Y800. 
-            pYUV420Buffer = (uint8_t*)av_malloc(length);
-            if (topDown)
-            {
-                memcpy(pYUV420Buffer, pInputBuffer, length);
-            }
-            else
-            {
-                for (int i = 0; i < height; i++)
-                {
-                    uint8_t* pDst = pYUV420Buffer + i * width;
-                    uint8_t* pSrc = pInputBuffer + ((height - 1 - i) * width);
-                    memcpy(pDst, pSrc, width);
-                }
-            }
+    Int64 then = m_swEncoding->ElapsedTicks;
+    
+    JPEGEncodingJob^ job = m_freeJobs->Take();
+    
+    if (job->input == nullptr || job->input->Length < _length)
+        job->input = gcnew array<System::Byte>((int)_length);
+
+    Buffer::BlockCopy(_buffer, 0, job->input, 0, (int)_length);
+    job->length = _length;
+    job->topDown = _topDown;
+    job->timestamp = _timestamp;
+    job->inputFormat = AV_PIX_FMT_BGRA;
+    if (_format == Kinovea::Services::ImageFormat::RGB24)
+        job->inputFormat = AV_PIX_FMT_BGR24;
+    else if (_format == Kinovea::Services::ImageFormat::Y800)
+        job->inputFormat = AV_PIX_FMT_GRAY8;
+    
+    job->done->Reset();
 
-            m_encodingDurationAccumulator += (m_swEncoding->ElapsedMilliseconds - then);
+    Interlocked::Increment(m_inFlight);
+    
+    // The muxing queue keeps the submission order, the encoding queue is served by whichever encoder is free.
+    m_muxingQueue->Add(job);
+    m_encodingQueue->Add(job);
 
-            WriteBuffer(length, _SavingContext, pYUV420Buffer, true);
-            written = true;
-            break;
-        }
+    Interlocked::Add(m_setupDurationAccumulator, m_swEncoding->ElapsedTicks - then);
+    
+    return true;
+}
 
-        avpicture_fill((AVPicture*)_SavingContext->pInputFrame, pInputBuffer, AV_PIX_FMT_GRAY8, width, height);
+///<summary>
+/// Encoding thread of the parallel mode. Converts and compresses jobs in whatever order they come.
+///</summary>
+void MJPEGWriter::EncoderWorker(Object^ _index)
+{
+    int index = safe_cast<int>(_index);
+    AVCodecContext* pCodecContext = (AVCodecContext*)m_SavingContext->encoderCodecContexts[index].ToPointer();
+    SwsContext* pScalingContext = (SwsContext*)m_SavingContext->encoderScalingContexts[index].ToPointer();
+    
+    for each (JPEGEncodingJob^ job in m_encodingQueue->GetConsumingEnumerable())
+    {
+        Int64 then = m_swEncoding->ElapsedTicks;
         
-        // Alter planes and stride to vertically flip image during conversion.
-        if (!topDown)
-        {
-          _SavingContext->pInputFrame->data[0] += _SavingContext->pInputFrame->linesize[0] * (height - 1);
-          _SavingContext->pInputFrame->linesize[0] = -_SavingContext->pInputFrame->linesize[0];
-        }
+        pin_ptr<uint8_t> pInputBuffer = &job->input[0];
+        job->success = ConvertToYUV420(pScalingContext, job->pInputFrame, pInputBuffer, job->inputFormat, job->topDown, job->pYUV420Frame, m_SavingContext->outputSize);
+        pInputBuffer = nullptr;
         
-        // Unfortunately the MJPEG encoder doesn't know how to work directly with Y800/GRAY8 images.
-        // Instead of directly pushing the buffer to the AVFrame we need to use an intermediate YUV420p frame.
+        Int64 now = m_swEncoding->ElapsedTicks;
+        job->conversionTicks = now - then;
+        then = now;
         
-        // Prepare the color space converted frame.
-        if ((pYUV420Frame = av_frame_alloc()) == nullptr) 
-        {
-            log->Error("YUV420P frame not allocated");
-            break;
-        }
-
-        int yuvBufferSize = avpicture_get_size(AV_PIX_FMT_YUV420P, width, height);
-        pYUV420Buffer = (uint8_t*)av_malloc(yuvBufferSize);
-        if (pYUV420Buffer == nullptr) 
+        if (job->success)
         {
-            log->Error("YUV frame buffer not allocated");
-            break;
+            job->iEncodedSize = avcodec_encode_video(pCodecContext, job->pEncodedBuffer, job->iEncodedBufferSize, job->pYUV420Frame);
+            job->success = job->iEncodedSize > 0;
         }
+        
+        job->encodingTicks = m_swEncoding->ElapsedTicks - then;
+        job->done->Set();
+    }
+}
 
-        avpicture_fill((AVPicture*)pYUV420Frame, pYUV420Buffer, AV_PIX_FMT_YUV420P, width, height);
+///<summary>
+/// Muxing thread of the parallel mode. Writes the jobs strictly in submission order and recycles them.
+///</summary>
+void MJPEGWriter::MuxerWorker()
+{
+    for each (JPEGEncodingJob^ job in m_muxingQueue->GetConsumingEnumerable())
+    {
+        job->done->Wait();
         
-        // Perform the color space conversion.
-        if (sws_scale(_SavingContext->pScalingContext, _SavingContext->pInputFrame->data, _SavingContext->pInputFrame->linesize, 0, height, pYUV420Frame->data, pYUV420Frame->linesize) < 0)
+        m_frame++;
+        Interlocked::Add(m_conversionDurationAccumulator, job->conversionTicks);
+        Interlocked::Add(m_encodingDurationAccumulator, job->encodingTicks);
+        
+        if (job->success)
         {
-            log->Error("Color conversion failed");
-            break;
+            m_SavingContext->iCurrentTimestamp = job->timestamp;
+            WriteBuffer(job->iEncodedSize, m_SavingContext, job->pEncodedBuffer, true);
         }
-        
-        int encodedSize = yuvBufferSize;
-        // Allocated JPEG frame buffer. 
-        // Assumes uncompressed size is always smaller than compressed. (Not technically true).
-        int jpegBufferSize = yuvBufferSize;
-        pJpegBuffer = (uint8_t*)av_malloc(jpegBufferSize);
-        if (pJpegBuffer == nullptr) 
+        else
         {
-            log->Error("output video buffer not allocated");
-            break;
+            log->Error("error while encoding output frame");
+            m_encodingFailed = true;
         }
-
-        // Actual encoding step.
-        encodedSize = avcodec_encode_video(_SavingContext->pOutputCodecContext, pJpegBuffer, jpegBufferSize, pYUV420Frame);
         
-        m_encodingDurationAccumulator += (m_swEncoding->ElapsedMilliseconds - then);
-
-        if (encodedSize <= 0)
-            break;
-
-        WriteBuffer(encodedSize, _SavingContext, pJpegBuffer, true);
-        written = true;
+        Interlocked::Decrement(m_inFlight);
+        m_freeJobs->Add(job);
     }
-    while(false);
-
-    if (pJpegBuffer != nullptr)
-        av_free(pJpegBuffer);
-
-    if (pYUV420Frame != nullptr)
-        av_free(pYUV420Frame);
-
-    if (pYUV420Buffer != nullptr)
-        av_free(pYUV420Buffer);
-    
-    return written;
 }
 
 ///<summary>
@@ -884,7 +1083,7 @@ bool MJPEGWriter::EncodeAndWriteVideoFrameJPEG(SavingContext^ _SavingContext, ar
 ///</summary>
 bool MJPEGWriter::WriteBuffer(int _iEncodedSize, SavingContext^ _SavingContext, uint8_t* _pOutputVideoBuffer, bool bForceKeyframe)
 {
-    Int64 then = m_swWrite->ElapsedMilliseconds;
+    Int64 then = m_swWrite->ElapsedTicks;
 
     AVPacket OutputPacket;
     av_init_packet(&OutputPacket);
@@ -893,7 +1092,8 @@ bool MJPEGWriter::WriteBuffer(int _iEncodedSize, SavingContext^ _SavingContext,
     OutputPacket.flags |= AV_PKT_FLAG_KEY;
     OutputPacket.data = _pOutputVideoBuffer;
     OutputPacket.size = _iEncodedSize;
-    OutputPacket.pts = 0;
+    OutputPacket.pts = ComputePts(_SavingContext);
+    OutputPacket.dts = OutputPacket.pts;
 
     // Commit the packet to the file.
     av_write_frame(_SavingContext->pOutputFormatContext, &OutputPacket);
@@ -906,13 +1106,49 @@ bool MJPEGWriter::WriteBuffer(int _iEncodedSize, SavingContext^ _SavingContext,
     fs->Write(managedBuffer, 0, _iEncodedSize);
     fs->Close();*/
     
-    m_writeDurationAccumulator += (m_swWrite->ElapsedMilliseconds - then);
+    Interlocked::Add(m_writeDurationAccumulator, m_swWrite->ElapsedTicks - then);
 
     LogStats();
 
     return true;
 }
 
+///<summary>
+/// MJPEGWriter::ComputePts
+/// Timestamp of the frame being written, in stream time base.
+///</summary>
+int64_t MJPEGWriter::ComputePts(SavingContext^ _SavingContext)
+{
+    AVRational streamTimeBase = _SavingContext->pOutputVideoStream->time_base;
+    int64_t pts;
+    
+    if (_SavingContext->iCurrentTimestamp < 0)
+    {
+        // No capture time, assume a constant frame rate.
+        pts = av_rescale_q(_SavingContext->iNextPts, _SavingContext->pOutputCodecContext->time_base, streamTimeBase);
+    }
+    else
+    {
+        if (_SavingContext->iFirstTimestamp < 0)
+            _SavingContext->iFirstTimestamp = _SavingContext->iCurrentTimestamp;
+        
+        // For high speed recording the file plays slower than real time.
+        AVRational microseconds = { 1, 1000000 };
+        int64_t elapsed = (int64_t)((_SavingContext->iCurrentTimestamp - _SavingContext->iFirstTimestamp) * _SavingContext->fTimestampScale);
+        pts = av_rescale_q(elapsed, microseconds, streamTimeBase);
+    }
+
+    // Timestamps must be strictly increasing.
+    // With a coarse time base like AVI's (one tick per frame) jitter can put two frames on the same tick.
+    if (pts <= _SavingContext->iLastPts)
+        pts = _SavingContext->iLastPts + 1;
+    
+    _SavingContext->iLastPts = pts;
+    _SavingContext->iNextPts++;
+    
+    return pts;
+}
+
 void MJPEGWriter::LogError(String^ context, int error)
 {
     char errbuf[256];
@@ -926,11 +1162,30 @@ void MJPEGWriter::LogStats()
     if (m_frame % 100 != 0)
         return;
     
-    log->DebugFormat("Frame #{0}. Conversion/Encoding: ~{1:0.000} ms. Write: ~{2:0.000} ms.",
-        m_frame, (float)m_encodingDurationAccumulator / 100, (float)m_writeDurationAccumulator / 100);
+    log->DebugFormat("Frame #{0}. Setup: ~{1:0.000} ms. Conversion: ~{2:0.000} ms. Encoding: ~{3:0.000} ms. Write: ~{4:0.000} ms.",
+        m_frame, 
+        TicksToMilliseconds(Interlocked::Exchange(m_setupDurationAccumulator, 0)) / 100, 
+        TicksToMilliseconds(Interlocked::Exchange(m_conversionDurationAccumulator, 0)) / 100,
+        TicksToMilliseconds(Interlocked::Exchange(m_encodingDurationAccumulator, 0)) / 100, 
+        TicksToMilliseconds(Interlocked::Exchange(m_writeDurationAccumulator, 0)) / 100);
+
+    if (m_fileWriter != nullptr)
+    {
+        Int64 writes = m_fileWriter->Writes;
+        log->DebugFormat("Disk: {0} writes, ~{1:0.000} ms, max {2:0.000} ms. Queue depth: {3}, max {4}.",
+            writes,
+            writes > 0 ? TicksToMilliseconds(m_fileWriter->WriteTicks) / writes : 0.0,
+            TicksToMilliseconds(m_fileWriter->MaxWriteTicks),
+            m_fileWriter->QueueDepth,
+            m_fileWriter->MaxQueueDepth);
+
+        m_fileWriter->ResetStats();
+    }
+}
 
-    m_encodingDurationAccumulator = 0;
-    m_writeDurationAccumulator = 0;
+double MJPEGWriter::TicksToMilliseconds(Int64 ticks)
+{
+    return (ticks * 1000.0) / Stopwatch::Frequency;
 }
 
 int MJPEGWriter::GreatestCommonDenominator(int a, int b)
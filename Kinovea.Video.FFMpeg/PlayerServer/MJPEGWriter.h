@@ -33,8 +33,11 @@ extern "C"
 }
 
 #include "SavingContext.h"
+#include "JPEGEncodingJob.h"
+#include "AsyncFileWriter.h"
 
 using namespace System;
+using namespace System::Collections::Concurrent;
 using namespace System::Collections::Generic;				
 using namespace System::ComponentModel;
 using namespace System::Diagnostics;
@@ -58,11 +61,40 @@ namespace Kinovea { namespace Video { namespace FFMpeg
     protected:
         !MJPEGWriter();
 
+    // Properties
+    public:
+        /// <summary>
+        /// Number of threads converting and compressing frames in parallel. 
+        /// 0 means automatic, 1 (the default) encodes on the caller thread. Must be set before opening the saving context.
+        /// </summary>
+        property int EncoderThreads
+        {
+            int get() { return m_encoderThreads; }
+            void set(int value) { m_encoderThreads = value; }
+        }
+
+        /// <summary>
+        /// Number of frames queued for encoding and not yet written to the file.
+        /// </summary>
+        property int InFlight
+        {
+            int get() { return m_inFlight; }
+        }
+
+        /// <summary>
+        /// Maximum number of frames that can be queued before SaveFrame blocks. 0 if encoding on the caller thread.
+        /// </summary>
+        property int InFlightCapacity
+        {
+            int get() { return m_inFlightCapacity; }
+        }
+
     // Public Methods
     public:
         SaveResult OpenSavingContext(String^ _FilePath, VideoInfo _info, String^ _formatString, Kinovea::Services::ImageFormat _imageFormat, bool _uncompressed, double _fFramesInterval, double _fFileFramesInterval, ImageRotation rotation);
         SaveResult CloseSavingContext(bool _bEncodingSuccess);
         SaveResult SaveFrame(Kinovea::Services::ImageFormat format, array<System::Byte>^ buffer, Int64 length, bool topDown);
+        SaveResult SaveFrame(Kinovea::Services::ImageFormat format, array<System::Byte>^ buffer, Int64 length, bool topDown, Int64 timestamp);
 
     // Private Methods
     private:
@@ -74,21 +106,51 @@ namespace Kinovea { namespace Video { namespace FFMpeg
         bool EncodeAndWriteVideoFrameRGB24(SavingContext^ _SavingContext, array<System::Byte>^ managedBuffer, Int64 length, bool topDown);
         bool EncodeAndWriteVideoFrameY800(SavingContext^ _SavingContext, array<System::Byte>^ managedBuffer, Int64 length, bool topDown);
         bool EncodeAndWriteVideoFrameJPEG(SavingContext^ _SavingContext, array<System::Byte>^ managedBuffer, Int64 length);
+        bool ConvertEncodeAndWrite(SavingContext^ _SavingContext, uint8_t* _pInputBuffer, AVPixelFormat _inputFormat, bool _topDown, Int64 _then);
+        bool AllocateFrameBuffers(SavingContext^ _SavingContext);
+        void FreeFrameBuffers(SavingContext^ _SavingContext);
+        static bool ConvertToYUV420(SwsContext* _pScalingContext, AVFrame* _pInputFrame, uint8_t* _pInputBuffer, AVPixelFormat _inputFormat, bool _topDown, AVFrame* _pYUV420Frame, Size _size);
+        
+        bool StartEncoderThreads(SavingContext^ _SavingContext, AVPixelFormat _inputFormat, int _threads);
+        void StopEncoderThreads();
+        void FreeEncoderThreads(SavingContext^ _SavingContext);
+        bool QueueFrame(Kinovea::Services::ImageFormat _format, array<System::Byte>^ _buffer, Int64 _length, bool _topDown, Int64 _timestamp);
+        void EncoderWorker(Object^ _index);
+        void MuxerWorker();
 
         bool WriteBuffer(int _iEncodedSize, SavingContext^ _SavingContext, uint8_t* _pOutputVideoBuffer, bool _bForceKeyframe);
+        int64_t ComputePts(SavingContext^ _SavingContext);
         void SanityCheck(AVFormatContext* s);
         void LogError(String^ context, int ffmpegError);
         void LogStats();
+        static double TicksToMilliseconds(Int64 ticks);
         static int GreatestCommonDenominator(int a, int b);
 
     // Members
     private :
         SavingContext^ m_SavingContext;
+        AsyncFileWriter^ m_fileWriter;
         Stopwatch^ m_swEncoding;
         Stopwatch^ m_swWrite;
         int m_frame;
+        // Durations in stopwatch ticks, the components are well under a millisecond.
+        // In parallel mode they are updated from both the recording thread and the muxer thread, always through Interlocked.
+        Int64 m_setupDurationAccumulator;
+        Int64 m_conversionDurationAccumulator;
         Int64 m_encodingDurationAccumulator;
         Int64 m_writeDurationAccumulator;
+
+        // Parallel encoding.
+        int m_encoderThreads;
+        int m_inFlight;
+        int m_inFlightCapacity;
+        volatile bool m_encodingFailed;
+        array<Thread^>^ m_encoders;
+        Thread^ m_muxer;
+        array<JPEGEncodingJob^>^ m_jobs;
+        BlockingCollection<JPEGEncodingJob^>^ m_freeJobs;
+        BlockingCollection<JPEGEncodingJob^>^ m_encodingQueue;
+        BlockingCollection<JPEGEncodingJob^>^ m_muxingQueue;
         static const double megabyte = 1024 * 1024;
         static log4net::ILog^ log = log4net::LogManager::GetLogger(MethodBase::GetCurrentMethod()->DeclaringType);
     };
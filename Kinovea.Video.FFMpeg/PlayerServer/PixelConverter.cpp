@@ -0,0 +1,205 @@
+#pragma region License
+/*
+Copyright  Joan Charmant 2021.
+jcharmant@gmail.com
+
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#include "PixelConverter.h"
+
+using namespace Kinovea::Video::FFMpeg;
+
+String^ PixelConverter::InstructionSet::get()
+{
+    switch (PixelKernels::GetSimdLevel())
+    {
+    case PixelKernels::SimdLevel::AVX2:
+        return "AVX2";
+    case PixelKernels::SimdLevel::SSSE3:
+        return "SSSE3";
+    default:
+        return "Scalar";
+    }
+}
+
+bool PixelConverter::UseReference::get()
+{
+    return PixelKernels::GetSimdLevel() == PixelKernels::SimdLevel::Scalar;
+}
+
+void PixelConverter::UseReference::set(bool value)
+{
+    PixelKernels::SetSimdLevel(value ? PixelKernels::SimdLevel::Scalar : PixelKernels::DetectSimdLevel());
+}
+
+///<summary>
+/// Copy a dense camera buffer into an RGB24 bitmap of the same size, with vertical flip for bottom-up buffers.
+/// Returns false if the format is not supported or the buffer is too small.
+///</summary>
+bool PixelConverter::Fill(Bitmap^ _bitmap, array<System::Byte>^ _buffer, Kinovea::Services::ImageFormat _format, bool _topDown)
+{
+    if (_bitmap->PixelFormat != PixelFormat::Format24bppRgb)
+        return false;
+
+    int width = _bitmap->Width;
+    int height = _bitmap->Height;
+    int srcStride;
+    switch (_format)
+    {
+    case Kinovea::Services::ImageFormat::RGB24:
+        srcStride = width * 3;
+        break;
+    case Kinovea::Services::ImageFormat::RGB32:
+        srcStride = width * 4;
+        break;
+    case Kinovea::Services::ImageFormat::Y800:
+        srcStride = width;
+        break;
+    default:
+        return false;
+    }
+
+    if (_buffer->Length < srcStride * height)
+        return false;
+
+    Rectangle rect(0, 0, width, height);
+    BitmapData^ bmpData = _bitmap->LockBits(rect, ImageLockMode::WriteOnly, _bitmap->PixelFormat);
+    pin_ptr<System::Byte> pBuffer = &_buffer[0];
+    uint8_t* pDst = (uint8_t*)bmpData->Scan0.ToPointer();
+    bool flip = !_topDown;
+
+    switch (_format)
+    {
+    case Kinovea::Services::ImageFormat::RGB24:
+        PixelKernels::CopyRows(pBuffer, srcStride, pDst, bmpData->Stride, srcStride, height, flip);
+        break;
+    case Kinovea::Services::ImageFormat::RGB32:
+        PixelKernels::RGB32ToRGB24(pBuffer, srcStride, pDst, bmpData->Stride, width, height, flip);
+        break;
+    case Kinovea::Services::ImageFormat::Y800:
+        PixelKernels::Y800ToRGB24(pBuffer, srcStride, pDst, bmpData->Stride, width, height, flip);
+        break;
+    }
+
+    _bitmap->UnlockBits(bmpData);
+    return true;
+}
+
+///<summary>
+/// Demosaic a dense 8-bit raw buffer into an RGB24 bitmap of the same size.
+///</summary>
+bool PixelConverter::FillFromBayer(Bitmap^ _bitmap, array<System::Byte>^ _buffer, Demosaicing _pattern, bool _topDown)
+{
+    if (_bitmap->PixelFormat != PixelFormat::Format24bppRgb)
+        return false;
+
+    int width = _bitmap->Width;
+    int height = _bitmap->Height;
+    if (width < 2 || height < 2 || _buffer->Length < width * height)
+        return false;
+
+    PixelKernels::BayerPattern pattern;
+    switch (_pattern)
+    {
+    case Demosaicing::RGGB:
+        pattern = PixelKernels::BayerPattern::RGGB;
+        break;
+    case Demosaicing::BGGR:
+        pattern = PixelKernels::BayerPattern::BGGR;
+        break;
+    case Demosaicing::GRBG:
+        pattern = PixelKernels::BayerPattern::GRBG;
+        break;
+    case Demosaicing::GBRG:
+        pattern = PixelKernels::BayerPattern::GBRG;
+        break;
+    default:
+        return false;
+    }
+
+    Rectangle rect(0, 0, width, height);
+    BitmapData^ bmpData = _bitmap->LockBits(rect, ImageLockMode::WriteOnly, _bitmap->PixelFormat);
+    pin_ptr<System::Byte> pBuffer = &_buffer[0];
+    uint8_t* pDst = (uint8_t*)bmpData->Scan0.ToPointer();
+
+    PixelKernels::BayerToRGB24(pBuffer, width, pDst, bmpData->Stride, width, height, pattern, !_topDown);
+
+    _bitmap->UnlockBits(bmpData);
+    return true;
+}
+
+///<summary>
+/// Rotate clockwise and mirror horizontally into a new bitmap, this is the equivalent of Bitmap::RotateFlip.
+/// Supports 8-bit indexed, 24-bit and 32-bit images. Returns null for other formats.
+///</summary>
+Bitmap^ PixelConverter::Transform(Bitmap^ _src, ImageRotation _rotation, bool _mirror)
+{
+    int bytesPerPixel = GetBytesPerPixel(_src->PixelFormat);
+    if (bytesPerPixel == 0)
+        return nullptr;
+
+    int width = _src->Width;
+    int height = _src->Height;
+    int angle = 0;
+    switch (_rotation)
+    {
+    case ImageRotation::Rotate90:
+        angle = 90;
+        break;
+    case ImageRotation::Rotate180:
+        angle = 180;
+        break;
+    case ImageRotation::Rotate270:
+        angle = 270;
+        break;
+    }
+
+    bool sideways = angle == 90 || angle == 270;
+    Bitmap^ dst = gcnew Bitmap(sideways ? height : width, sideways ? width : height, _src->PixelFormat);
+    if (bytesPerPixel == 1)
+        dst->Palette = _src->Palette;
+
+    BitmapData^ srcData = _src->LockBits(Rectangle(0, 0, width, height), ImageLockMode::ReadOnly, _src->PixelFormat);
+    BitmapData^ dstData = dst->LockBits(Rectangle(0, 0, dst->Width, dst->Height), ImageLockMode::WriteOnly, dst->PixelFormat);
+
+    PixelKernels::Rotate(
+        (uint8_t*)srcData->Scan0.ToPointer(), srcData->Stride,
+        (uint8_t*)dstData->Scan0.ToPointer(), dstData->Stride,
+        width, height, bytesPerPixel, angle, _mirror);
+
+    dst->UnlockBits(dstData);
+    _src->UnlockBits(srcData);
+    return dst;
+}
+
+int PixelConverter::GetBytesPerPixel(PixelFormat _format)
+{
+    switch (_format)
+    {
+    case PixelFormat::Format8bppIndexed:
+        return 1;
+    case PixelFormat::Format24bppRgb:
+        return 3;
+    case PixelFormat::Format32bppArgb:
+    case PixelFormat::Format32bppPArgb:
+    case PixelFormat::Format32bppRgb:
+        return 4;
+    default:
+        return 0;
+    }
+}
@@ -0,0 +1,73 @@
+#pragma region License
+/*
+Copyright  Joan Charmant 2021.
+jcharmant@gmail.com
+
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#pragma once
+
+#include "PixelKernels.h"
+
+using namespace System;
+using namespace System::Drawing;
+using namespace System::Drawing::Imaging;
+using namespace System::Reflection;
+using namespace Kinovea::Services;
+
+namespace Kinovea { namespace Video { namespace FFMpeg
+{
+    /// <summary>
+    /// Managed entry point to the native pixel kernels.
+    /// Fills RGB24 bitmaps from raw camera buffers and rotates images without going through GDI+.
+    /// </summary>
+    public ref class PixelConverter abstract sealed
+    {
+    public:
+        /// <summary>
+        /// Instruction set used by the kernels.
+        /// </summary>
+        static property String^ InstructionSet {
+            String^ get();
+        }
+
+        /// <summary>
+        /// Force the scalar reference implementation, for correctness tests and benchmarks.
+        /// </summary>
+        static property bool UseReference {
+            bool get();
+            void set(bool value);
+        }
+
+    public:
+        static PixelConverter()
+        {
+            log->DebugFormat("Pixel conversion instruction set: {0}.", InstructionSet);
+        }
+
+        static bool Fill(Bitmap^ _bitmap, array<System::Byte>^ _buffer, Kinovea::Services::ImageFormat _format, bool _topDown);
+        static bool FillFromBayer(Bitmap^ _bitmap, array<System::Byte>^ _buffer, Demosaicing _pattern, bool _topDown);
+        static Bitmap^ Transform(Bitmap^ _src, ImageRotation _rotation, bool _mirror);
+
+    private:
+        static int GetBytesPerPixel(PixelFormat _format);
+
+    private:
+        static log4net::ILog^ log = log4net::LogManager::GetLogger(MethodBase::GetCurrentMethod()->DeclaringType);
+    };
+}}}
@@ -0,0 +1,698 @@
+#pragma region License
+/*
+Copyright  Joan Charmant 2021.
+jcharmant@gmail.com
+
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+// This file is compiled as native code (no /clr), the intrinsics are not supported in managed functions.
+// The SSSE3 and AVX2 functions are only called after the runtime check, the rest of the file must stay SSE2.
+
+#include <stddef.h>
+#include <string.h>
+#include <intrin.h>
+#include <immintrin.h>
+#include "PixelKernels.h"
+
+namespace Kinovea { namespace Video { namespace FFMpeg { namespace PixelKernels
+{
+    namespace
+    {
+        // Size of the square tiles walked by the rotation, in pixels.
+        const int RotationTileSize = 32;
+
+        SimdLevel s_Detected = DetectSimdLevel();
+        SimdLevel s_Level = s_Detected;
+
+        struct Pixel24
+        {
+            uint8_t b, g, r;
+        };
+
+        inline void FlipDestination(uint8_t*& _dst, int& _dstStride, int _height, bool _flip)
+        {
+            if (!_flip)
+                return;
+
+            _dst += (ptrdiff_t)_dstStride * (_height - 1);
+            _dstStride = -_dstStride;
+        }
+
+        //------------------------------------------------------------------------------------
+        // RGB32 to RGB24.
+        //------------------------------------------------------------------------------------
+        void RowRGB32ToRGB24Scalar(const uint8_t* _src, uint8_t* _dst, int _count)
+        {
+            for (int x = 0; x < _count; x++)
+            {
+                _dst[0] = _src[0];
+                _dst[1] = _src[1];
+                _dst[2] = _src[2];
+                _src += 4;
+                _dst += 3;
+            }
+        }
+
+        void RowRGB32ToRGB24SSSE3(const uint8_t* _src, uint8_t* _dst, int _count)
+        {
+            // 16 pixels per iteration. Each block of 4 pixels is packed to 12 bytes at the bottom of the register,
+            // the four partial blocks are then stitched into three full stores.
+            const __m128i mask = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+            int x = 0;
+            for (; x + 16 <= _count; x += 16)
+            {
+                __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(_src + 0)), mask);
+                __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(_src + 16)), mask);
+                __m128i c = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(_src + 32)), mask);
+                __m128i d = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(_src + 48)), mask);
+
+                _mm_storeu_si128((__m128i*)(_dst + 0), _mm_or_si128(a, _mm_slli_si128(b, 12)));
+                _mm_storeu_si128((__m128i*)(_dst + 16), _mm_or_si128(_mm_srli_si128(b, 4), _mm_slli_si128(c, 8)));
+                _mm_storeu_si128((__m128i*)(_dst + 32), _mm_or_si128(_mm_srli_si128(c, 8), _mm_slli_si128(d, 4)));
+
+                _src += 64;
+                _dst += 48;
+            }
+
+            RowRGB32ToRGB24Scalar(_src, _dst, _count - x);
+        }
+
+        void RowRGB32ToRGB24AVX2(const uint8_t* _src, uint8_t* _dst, int _count)
+        {
+            // 8 pixels per iteration. Pack 12 bytes in each lane then move the two halves next to each other.
+            const __m256i mask = _mm256_setr_epi8(
+                0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+            const __m256i permutation = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+            int x = 0;
+            for (; x + 8 <= _count; x += 8)
+            {
+                __m256i v = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)_src), mask);
+                v = _mm256_permutevar8x32_epi32(v, permutation);
+
+                _mm_storeu_si128((__m128i*)_dst, _mm256_castsi256_si128(v));
+                _mm_storel_epi64((__m128i*)(_dst + 16), _mm256_extracti128_si256(v, 1));
+
+                _src += 32;
+                _dst += 24;
+            }
+
+            RowRGB32ToRGB24Scalar(_src, _dst, _count - x);
+        }
+
+        //------------------------------------------------------------------------------------
+        // Y800 to RGB24.
+        //------------------------------------------------------------------------------------
+        void RowY800ToRGB24Scalar(const uint8_t* _src, uint8_t* _dst, int _count)
+        {
+            for (int x = 0; x < _count; x++)
+            {
+                _dst[0] = _dst[1] = _dst[2] = *_src;
+                _src++;
+                _dst += 3;
+            }
+        }
+
+        void RowY800ToRGB24SSSE3(const uint8_t* _src, uint8_t* _dst, int _count)
+        {
+            // 16 pixels per iteration, each output register picks its bytes from the same input.
+            const __m128i mask0 = _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5);
+            const __m128i mask1 = _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10);
+            const __m128i mask2 = _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15);
+            int x = 0;
+            for (; x + 16 <= _count; x += 16)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i*)_src);
+                _mm_storeu_si128((__m128i*)(_dst + 0), _mm_shuffle_epi8(v, mask0));
+                _mm_storeu_si128((__m128i*)(_dst + 16), _mm_shuffle_epi8(v, mask1));
+                _mm_storeu_si128((__m128i*)(_dst + 32), _mm_shuffle_epi8(v, mask2));
+
+                _src += 16;
+                _dst += 48;
+            }
+
+            RowY800ToRGB24Scalar(_src, _dst, _count - x);
+        }
+
+        void RowY800ToRGB24AVX2(const uint8_t* _src, uint8_t* _dst, int _count)
+        {
+            // 16 pixels per iteration. The input is duplicated in both lanes so the first 32 bytes come from a single shuffle.
+            const __m256i mask01 = _mm256_setr_epi8(
+                0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5,
+                5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10);
+            const __m128i mask2 = _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15);
+            int x = 0;
+            for (; x + 16 <= _count; x += 16)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i*)_src);
+                _mm256_storeu_si256((__m256i*)_dst, _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(v), mask01));
+                _mm_storeu_si128((__m128i*)(_dst + 32), _mm_shuffle_epi8(v, mask2));
+
+                _src += 16;
+                _dst += 48;
+            }
+
+            RowY800ToRGB24Scalar(_src, _dst, _count - x);
+        }
+
+        typedef void (*RowConverter)(const uint8_t*, uint8_t*, int);
+
+        void ConvertRows(RowConverter _converter, const uint8_t* _src, int _srcStride, uint8_t* _dst, int _dstStride, int _width, int _height, bool _flip)
+        {
+            FlipDestination(_dst, _dstStride, _height, _flip);
+            for (int y = 0; y < _height; y++)
+            {
+                _converter(_src, _dst, _width);
+                _src += _srcStride;
+                _dst += _dstStride;
+            }
+        }
+
+        //------------------------------------------------------------------------------------
+        // Bayer to RGB24.
+        // Bilinear interpolation. All the averages are done two values at a time with rounding up,
+        // this is what the SIMD average instruction does, so the scalar and vector paths give the exact same result.
+        // The borders are mirrored so the neighbors keep the right color.
+        //------------------------------------------------------------------------------------
+        enum BayerColor { Red, Green, Blue };
+        enum BayerSource { Center, Horizontal, Vertical, Cross, Diagonal, BayerSources };
+
+        // Sources of the B, G and R outputs for even and odd columns of a given row.
+        struct BayerRowSources
+        {
+            int sources[2][3];
+        };
+
+        inline int Average(int _a, int _b)
+        {
+            return (_a + _b + 1) >> 1;
+        }
+
+        inline int Mirror(int _i, int _count)
+        {
+            if (_i < 0)
+                return -_i;
+            if (_i >= _count)
+                return 2 * _count - 2 - _i;
+            return _i;
+        }
+
+        BayerColor GetBayerColor(BayerPattern _pattern, int _x, int _y)
+        {
+            static const BayerColor colors[4][4] = {
+                { Red, Green, Green, Blue },     // RGGB
+                { Blue, Green, Green, Red },     // BGGR
+                { Green, Red, Blue, Green },     // GRBG
+                { Green, Blue, Red, Green }      // GBRG
+            };
+
+            return colors[(int)_pattern][(_y & 1) * 2 + (_x & 1)];
+        }
+
+        BayerRowSources GetBayerRowSources(BayerPattern _pattern, int _y)
+        {
+            BayerRowSources result;
+            for (int parity = 0; parity < 2; parity++)
+            {
+                int* s = result.sources[parity];
+                BayerColor site = GetBayerColor(_pattern, parity, _y);
+                BayerColor other = GetBayerColor(_pattern, parity + 1, _y);
+                if (site == Red)
+                {
+                    s[0] = Diagonal; s[1] = Cross; s[2] = Center;
+                }
+                else if (site == Blue)
+                {
+                    s[0] = Center; s[1] = Cross; s[2] = Diagonal;
+                }
+                else if (other == Red)
+                {
+                    s[0] = Vertical; s[1] = Center; s[2] = Horizontal;
+                }
+                else
+                {
+                    s[0] = Horizontal; s[1] = Center; s[2] = Vertical;
+                }
+            }
+
+            return result;
+        }
+
+        void RowBayerToRGB24Scalar(const uint8_t* _up, const uint8_t* _row, const uint8_t* _down, uint8_t* _dst, int _width, int _start, int _end, const BayerRowSources& _sources)
+        {
+            int values[BayerSources];
+            for (int x = _start; x < _end; x++)
+            {
+                int left = Mirror(x - 1, _width);
+                int right = Mirror(x + 1, _width);
+
+                values[Center] = _row[x];
+                values[Horizontal] = Average(_row[left], _row[right]);
+                values[Vertical] = Average(_up[x], _down[x]);
+                values[Cross] = Average(values[Horizontal], values[Vertical]);
+                values[Diagonal] = Average(Average(_up[left], _up[right]), Average(_down[left], _down[right]));
+
+                const int* s = _sources.sources[x & 1];
+                uint8_t* p = _dst + x * 3;
+                p[0] = (uint8_t)values[s[0]];
+                p[1] = (uint8_t)values[s[1]];
+                p[2] = (uint8_t)values[s[2]];
+            }
+        }
+
+        // Shuffle masks to interleave three planes of 16 bytes into 48 bytes of B, G, R triplets.
+        struct InterleaveMasks
+        {
+            __m128i masks[3][3];
+        };
+
+        InterleaveMasks BuildInterleaveMasks()
+        {
+            InterleaveMasks result;
+            for (int block = 0; block < 3; block++)
+            {
+                for (int channel = 0; channel < 3; channel++)
+                {
+                    alignas(16) int8_t mask[16];
+                    for (int i = 0; i < 16; i++)
+                    {
+                        int index = block * 16 + i;
+                        mask[i] = (index % 3 == channel) ? (int8_t)(index / 3) : (int8_t)-1;
+                    }
+
+                    result.masks[block][channel] = _mm_load_si128((const __m128i*)mask);
+                }
+            }
+
+            return result;
+        }
+
+        void RowBayerToRGB24SSSE3(const uint8_t* _up, const uint8_t* _row, const uint8_t* _down, uint8_t* _dst, int _width, const BayerRowSources& _sources, const InterleaveMasks& _masks)
+        {
+            // Columns 0 and 1 go through the scalar path for the mirrored border, the vector loop starts on an even column
+            // so even lanes are even columns, and stops before the last column.
+            int end = _width < 2 ? _width : 2;
+            RowBayerToRGB24Scalar(_up, _row, _down, _dst, _width, 0, end, _sources);
+
+            const __m128i evenLanes = _mm_set1_epi16(0x00FF);
+            int x = 2;
+            for (; x + 16 < _width; x += 16)
+            {
+                __m128i values[BayerSources];
+                __m128i h = _mm_avg_epu8(_mm_loadu_si128((const __m128i*)(_row + x - 1)), _mm_loadu_si128((const __m128i*)(_row + x + 1)));
+                __m128i v = _mm_avg_epu8(_mm_loadu_si128((const __m128i*)(_up + x)), _mm_loadu_si128((const __m128i*)(_down + x)));
+                __m128i up = _mm_avg_epu8(_mm_loadu_si128((const __m128i*)(_up + x - 1)), _mm_loadu_si128((const __m128i*)(_up + x + 1)));
+                __m128i down = _mm_avg_epu8(_mm_loadu_si128((const __m128i*)(_down + x - 1)), _mm_loadu_si128((const __m128i*)(_down + x + 1)));
+
+                values[Center] = _mm_loadu_si128((const __m128i*)(_row + x));
+                values[Horizontal] = h;
+                values[Vertical] = v;
+                values[Cross] = _mm_avg_epu8(h, v);
+                values[Diagonal] = _mm_avg_epu8(up, down);
+
+                __m128i planes[3];
+                for (int channel = 0; channel < 3; channel++)
+                {
+                    __m128i even = values[_sources.sources[0][channel]];
+                    __m128i odd = values[_sources.sources[1][channel]];
+                    planes[channel] = _mm_or_si128(_mm_and_si128(evenLanes, even), _mm_andnot_si128(evenLanes, odd));
+                }
+
+                uint8_t* p = _dst + x * 3;
+                for (int block = 0; block < 3; block++)
+                {
+                    __m128i out = _mm_shuffle_epi8(planes[0], _masks.masks[block][0]);
+                    out = _mm_or_si128(out, _mm_shuffle_epi8(planes[1], _masks.masks[block][1]));
+                    out = _mm_or_si128(out, _mm_shuffle_epi8(planes[2], _masks.masks[block][2]));
+                    _mm_storeu_si128((__m128i*)(p + block * 16), out);
+                }
+            }
+
+            RowBayerToRGB24Scalar(_up, _row, _down, _dst, _width, x, _width, _sources);
+        }
+
+        //------------------------------------------------------------------------------------
+        // Rotation.
+        // The transforms are expressed as a walk in the source: the address of the first destination pixel,
+        // the step in the source when moving right in the destination and the step when moving down.
+        //------------------------------------------------------------------------------------
+        struct RotationWalk
+        {
+            ptrdiff_t origin;
+            ptrdiff_t stepX;
+            ptrdiff_t stepY;
+            int width;
+            int height;
+        };
+
+        RotationWalk GetRotationWalk(int _srcStride, int _width, int _height, int _bytesPerPixel, int _angle, bool _mirror)
+        {
+            ptrdiff_t b = _bytesPerPixel;
+            ptrdiff_t s = _srcStride;
+            ptrdiff_t right = (ptrdiff_t)(_width - 1) * b;
+            ptrdiff_t bottom = (ptrdiff_t)(_height - 1) * s;
+
+            RotationWalk walk;
+            bool sideways = _angle == 90 || _angle == 270;
+            walk.width = sideways ? _height : _width;
+            walk.height = sideways ? _width : _height;
+
+            switch (_angle)
+            {
+            case 90:
+                walk.origin = _mirror ? 0 : bottom;
+                walk.stepX = _mirror ? s : -s;
+                walk.stepY = b;
+                break;
+            case 180:
+                walk.origin = _mirror ? bottom : bottom + right;
+                walk.stepX = _mirror ? b : -b;
+                walk.stepY = -s;
+                break;
+            case 270:
+                walk.origin = _mirror ? bottom + right : right;
+                walk.stepX = _mirror ? -s : s;
+                walk.stepY = -b;
+                break;
+            default:
+                walk.origin = _mirror ? right : 0;
+                walk.stepX = _mirror ? -b : b;
+                walk.stepY = s;
+                break;
+            }
+
+            return walk;
+        }
+
+        template<typename T>
+        void WalkRectangle(const uint8_t* _src, const RotationWalk& _walk, uint8_t* _dst, int _dstStride, int _left, int _top, int _right, int _bottom)
+        {
+            for (int y = _top; y < _bottom; y++)
+            {
+                const uint8_t* s = _src + _walk.origin + y * _walk.stepY + _left * _walk.stepX;
+                T* d = (T*)(_dst + (ptrdiff_t)y * _dstStride) + _left;
+                for (int x = _left; x < _right; x++)
+                {
+                    *d++ = *(const T*)s;
+                    s += _walk.stepX;
+                }
+            }
+        }
+
+        template<typename T>
+        void WalkTiled(const uint8_t* _src, const RotationWalk& _walk, uint8_t* _dst, int _dstStride)
+        {
+            // The destination is walked by square tiles so that both the rows and the columns of the source stay in cache.
+            for (int ty = 0; ty < _walk.height; ty += RotationTileSize)
+            {
+                int bottom = ty + RotationTileSize < _walk.height ? ty + RotationTileSize : _walk.height;
+                for (int tx = 0; tx < _walk.width; tx += RotationTileSize)
+                {
+                    int right = tx + RotationTileSize < _walk.width ? tx + RotationTileSize : _walk.width;
+                    WalkRectangle<T>(_src, _walk, _dst, _dstStride, tx, ty, right, bottom);
+                }
+            }
+        }
+
+        void RotateScalar(const uint8_t* _src, const RotationWalk& _walk, uint8_t* _dst, int _dstStride, int _bytesPerPixel)
+        {
+            if (_walk.stepX == _bytesPerPixel)
+            {
+                // Vertical flip.
+                for (int y = 0; y < _walk.height; y++)
+                    memcpy(_dst + (ptrdiff_t)y * _dstStride, _src + _walk.origin + y * _walk.stepY, (size_t)_walk.width * _bytesPerPixel);
+
+                return;
+            }
+
+            switch (_bytesPerPixel)
+            {
+            case 1:
+                WalkTiled<uint8_t>(_src, _walk, _dst, _dstStride);
+                break;
+            case 3:
+                WalkTiled<Pixel24>(_src, _walk, _dst, _dstStride);
+                break;
+            case 4:
+            default:
+                WalkTiled<uint32_t>(_src, _walk, _dst, _dstStride);
+                break;
+            }
+        }
+
+        void ReverseRowsSSSE3(const uint8_t* _src, const RotationWalk& _walk, uint8_t* _dst, int _dstStride, int _bytesPerPixel)
+        {
+            // Source rows map to destination rows in reverse order. Whole pixels are loaded from the far end of the block
+            // and reversed in the register. The 24-bit variant moves 5 pixels per iteration and writes one byte past them,
+            // so it starts at the second pixel (to never read past the end of the source row) and stops early enough.
+            const __m128i reverse8 = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+            const __m128i reverse24 = _mm_setr_epi8(12, 13, 14, 9, 10, 11, 6, 7, 8, 3, 4, 5, 0, 1, 2, -1);
+            int b = _bytesPerPixel;
+            for (int y = 0; y < _walk.height; y++)
+            {
+                const uint8_t* s = _src + _walk.origin + y * _walk.stepY;
+                uint8_t* d = _dst + (ptrdiff_t)y * _dstStride;
+                int x = 0;
+                switch (b)
+                {
+                case 1:
+                    for (; x + 16 <= _walk.width; x += 16)
+                    {
+                        __m128i v = _mm_loadu_si128((const __m128i*)(s - (x + 15)));
+                        _mm_storeu_si128((__m128i*)(d + x), _mm_shuffle_epi8(v, reverse8));
+                    }
+                    break;
+                case 3:
+                    memcpy(d, s, 3);
+                    for (x = 1; x + 6 <= _walk.width; x += 5)
+                    {
+                        __m128i v = _mm_loadu_si128((const __m128i*)(s - (ptrdiff_t)(x + 4) * 3));
+                        _mm_storeu_si128((__m128i*)(d + x * 3), _mm_shuffle_epi8(v, reverse24));
+                    }
+                    break;
+                case 4:
+                    for (; x + 4 <= _walk.width; x += 4)
+                    {
+                        __m128i v = _mm_loadu_si128((const __m128i*)(s - (ptrdiff_t)(x + 3) * 4));
+                        _mm_storeu_si128((__m128i*)(d + x * 4), _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3)));
+                    }
+                    break;
+                }
+
+                for (; x < _walk.width; x++)
+                    memcpy(d + x * b, s - (ptrdiff_t)x * b, b);
+            }
+        }
+    }
+
+    //----------------------------------------------------------------------------------------
+    // Dispatch.
+    //----------------------------------------------------------------------------------------
+    SimdLevel DetectSimdLevel()
+    {
+        int info[4];
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
+        if (maxLeaf < 1)
+            return SimdLevel::Scalar;
+
+        __cpuid(info, 1);
+        bool ssse3 = (info[2] & (1 << 9)) != 0;
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (!ssse3)
+            return SimdLevel::Scalar;
+
+        if (maxLeaf < 7 || !osxsave || !avx)
+            return SimdLevel::SSSE3;
+
+        // The OS must save the YMM registers on context switch.
+        if ((_xgetbv(0) & 6) != 6)
+            return SimdLevel::SSSE3;
+
+        __cpuidex(info, 7, 0);
+        bool avx2 = (info[1] & (1 << 5)) != 0;
+        return avx2 ? SimdLevel::AVX2 : SimdLevel::SSSE3;
+    }
+
+    SimdLevel GetSimdLevel()
+    {
+        return s_Level;
+    }
+
+    void SetSimdLevel(SimdLevel _level)
+    {
+        s_Level = _level < s_Detected ? _level : s_Detected;
+    }
+
+    void CopyRows(const uint8_t* _src, int _srcStride, uint8_t* _dst, int _dstStride, int _rowBytes, int _height, bool _flip)
+    {
+        FlipDestination(_dst, _dstStride, _height, _flip);
+        for (int y = 0; y < _height; y++)
+        {
+            memcpy(_dst, _src, _rowBytes);
+            _src += _srcStride;
+            _dst += _dstStride;
+        }
+    }
+
+    void RGB32ToRGB24(const uint8_t* _src, int _srcStride, uint8_t* _dst, int _dstStride, int _width, int _height, bool _flip)
+    {
+        switch (s_Level)
+        {
+        case SimdLevel::AVX2:
+            ConvertRows(RowRGB32ToRGB24AVX2, _src, _srcStride, _dst, _dstStride, _width, _height, _flip);
+            break;
+        case SimdLevel::SSSE3:
+            ConvertRows(RowRGB32ToRGB24SSSE3, _src, _srcStride, _dst, _dstStride, _width, _height, _flip);
+            break;
+        default:
+            Reference::RGB32ToRGB24(_src, _srcStride, _dst, _dstStride, _width, _height, _flip);
+            break;
+        }
+    }
+
+    void Y800ToRGB24(const uint8_t* _src, int _srcStride, uint8_t* _dst, int _dstStride, int _width, int _height, bool _flip)
+    {
+        switch (s_Level)
+        {
+        case SimdLevel::AVX2:
+            ConvertRows(RowY800ToRGB24AVX2, _src, _srcStride, _dst, _dstStride, _width, _height, _flip);
+            break;
+        case SimdLevel::SSSE3:
+            ConvertRows(RowY800ToRGB24SSSE3, _src, _srcStride, _dst, _dstStride, _width, _height, _flip);
+            break;
+        default:
+            Reference::Y800ToRGB24(_src, _srcStride, _dst, _dstStride, _width, _height, _flip);
+            break;
+        }
+    }
+
+    void BayerToRGB24(const uint8_t* _src, int _srcStride, uint8_t* _dst, int _dstStride, int _width, int _height, BayerPattern _pattern, bool _flip)
+    {
+        // The demosaicing is bound by the number of loads rather than the register width, there is no AVX2 variant.
+        if (s_Level == SimdLevel::Scalar || _width < 2 || _height < 2)
+        {
+            Reference::BayerToRGB24(_src, _srcStride, _dst, _dstStride, _width, _height, _pattern, _flip);
+            return;
+        }
+
+        InterleaveMasks masks = BuildInterleaveMasks();
+        FlipDestination(_dst, _dstStride, _height, _flip);
+        for (int y = 0; y < _height; y++)
+        {
+            const uint8_t* up = _src + (ptrdiff_t)Mirror(y - 1, _height) * _srcStride;
+            const uint8_t* row = _src + (ptrdiff_t)y * _srcStride;
+            const uint8_t* down = _src + (ptrdiff_t)Mirror(y + 1, _height) * _srcStride;
+            BayerRowSources sources = GetBayerRowSources(_pattern, y);
+            RowBayerToRGB24SSSE3(up, row, down, _dst + (ptrdiff_t)y * _dstStride, _width, sources, masks);
+        }
+    }
+
+    void Rotate(const uint8_t* _src, int _srcStride, uint8_t* _dst, int _dstStride, int _width, int _height, int _bytesPerPixel, int _angle, bool _mirror)
+    {
+        if (_angle == 0 && !_mirror)
+        {
+            CopyRows(_src, _srcStride, _dst, _dstStride, _width * _bytesPerPixel, _height, false);
+            return;
+        }
+
+        if (s_Level == SimdLevel::Scalar)
+        {
+            Reference::Rotate(_src, _srcStride, _dst, _dstStride, _width, _height, _bytesPerPixel, _angle, _mirror);
+            return;
+        }
+
+        RotationWalk walk = GetRotationWalk(_srcStride, _width, _height, _bytesPerPixel, _angle, _mirror);
+        // Rotations by 90 and 270 are bound by the memory access pattern, the tiled walk is as fast as a vectorized transpose.
+        if (walk.stepX == -_bytesPerPixel)
+            ReverseRowsSSSE3(_src, walk, _dst, _dstStride, _bytesPerPixel);
+        else
+            RotateScalar(_src, walk, _dst, _dstStride, _bytesPerPixel);
+    }
+
+    //----------------------------------------------------------------------------------------
+    // Reference implementations.
+    //----------------------------------------------------------------------------------------
+    namespace Reference
+    {
+        void RGB32ToRGB24(const uint8_t* _src, int _srcStride, uint8_t* _dst, int _dstStride, int _width, int _height, bool _flip)
+        {
+            ConvertRows(RowRGB32ToRGB24Scalar, _src, _srcStride, _dst, _dstStride, _width, _height, _flip);
+        }
+
+        void Y800ToRGB24(const uint8_t* _src, int _srcStride, uint8_t* _dst, int _dstStride, int _width, int _height, bool _flip)
+        {
+            ConvertRows(RowY800ToRGB24Scalar, _src, _srcStride, _dst, _dstStride, _width, _height, _flip);
+        }
+
+        void BayerToRGB24(const uint8_t* _src, int _srcStride, uint8_t* _dst, int _dstStride, int _width, int _height, BayerPattern _pattern, bool _flip)
+        {
+            if (_width < 2 || _height < 2)
+                return;
+
+            FlipDestination(_dst, _dstStride, _height, _flip);
+            for (int y = 0; y < _height; y++)
+            {
+                const uint8_t* up = _src + (ptrdiff_t)Mirror(y - 1, _height) * _srcStride;
+                const uint8_t* row = _src + (ptrdiff_t)y * _srcStride;
+                const uint8_t* down = _src + (ptrdiff_t)Mirror(y + 1, _height) * _srcStride;
+                BayerRowSources sources = GetBayerRowSources(_pattern, y);
+                RowBayerToRGB24Scalar(up, row, down, _dst + (ptrdiff_t)y * _dstStride, _width, 0, _width, sources);
+            }
+        }
+
+        void Rotate(const uint8_t* _src, int _srcStride, uint8_t* _dst, int _dstStride, int _width, int _height, int _bytesPerPixel, int _angle, bool _mirror)
+        {
+            // Straight pixel by pixel mapping from the source coordinates, independent from the walks used by the fast path.
+            bool sideways = _angle == 90 || _angle == 270;
+            int dstWidth = sideways ? _height : _width;
+            for (int y = 0; y < _height; y++)
+            {
+                for (int x = 0; x < _width; x++)
+                {
+                    int dx, dy;
+                    switch (_angle)
+                    {
+                    case 90:
+                        dx = _height - 1 - y;
+                        dy = x;
+                        break;
+                    case 180:
+                        dx = _width - 1 - x;
+                        dy = _height - 1 - y;
+                        break;
+                    case 270:
+                        dx = y;
+                        dy = _width - 1 - x;
+                        break;
+                    default:
+                        dx = x;
+                        dy = y;
+                        break;
+                    }
+
+                    if (_mirror)
+                        dx = dstWidth - 1 - dx;
+
+                    memcpy(_dst + (ptrdiff_t)dy * _dstStride + dx * _bytesPerPixel, _src + (ptrdiff_t)y * _srcStride + x * _bytesPerPixel, _bytesPerPixel);
+                }
+            }
+        }
+    }
+}}}}
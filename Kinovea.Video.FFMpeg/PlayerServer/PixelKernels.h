@@ -0,0 +1,86 @@
+#pragma region License
+/*
+Copyright  Joan Charmant 2021.
+jcharmant@gmail.com
+
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+
+*/
+#pragma endregion
+
+#pragma once
+
+#include <stdint.h>
+
+// Pixel conversion and rotation kernels shared by the capture display, the delay buffer and the file reader.
+// This header is pure native code so it can be included from both managed and unmanaged translation units.
+// The kernels themselves are compiled without /clr.
+//
+// All the functions take raw pointers and strides in bytes. The 24-bit output is in Windows byte order (B, G, R).
+// When `flip` is set the rows are written in reverse order, this converts between bottom-up and top-down images.
+namespace Kinovea { namespace Video { namespace FFMpeg { namespace PixelKernels
+{
+    enum class SimdLevel
+    {
+        Scalar = 0,
+        SSSE3 = 1,
+        AVX2 = 2
+    };
+
+    // Color of the top-left 2x2 block of the sensor, row by row.
+    enum class BayerPattern
+    {
+        RGGB,
+        BGGR,
+        GRBG,
+        GBRG
+    };
+
+    // Best instruction set supported by the CPU and the OS.
+    SimdLevel DetectSimdLevel();
+
+    // Instruction set currently used by the dispatcher.
+    SimdLevel GetSimdLevel();
+
+    // Restrict the dispatcher to a lower instruction set, for testing and benchmarking.
+    // Levels above what the CPU supports are clamped.
+    void SetSimdLevel(SimdLevel _level);
+
+    // Row by row copy, with optional vertical flip.
+    void CopyRows(const uint8_t* _src, int _srcStride, uint8_t* _dst, int _dstStride, int _rowBytes, int _height, bool _flip);
+
+    // BGRA to BGR, the alpha channel is dropped.
+    void RGB32ToRGB24(const uint8_t* _src, int _srcStride, uint8_t* _dst, int _dstStride, int _width, int _height, bool _flip);
+
+    // Gray to BGR.
+    void Y800ToRGB24(const uint8_t* _src, int _srcStride, uint8_t* _dst, int _dstStride, int _width, int _height, bool _flip);
+
+    // Bilinear demosaicing of 8-bit raw sensor data. The image must be at least 2x2.
+    void BayerToRGB24(const uint8_t* _src, int _srcStride, uint8_t* _dst, int _dstStride, int _width, int _height, BayerPattern _pattern, bool _flip);
+
+    // Clockwise rotation by 0, 90, 180 or 270 degrees, followed by an optional horizontal mirror.
+    // Width and height are the dimensions of the source image, the destination must not overlap the source.
+    // Supports 1, 3 and 4 bytes per pixel.
+    void Rotate(const uint8_t* _src, int _srcStride, uint8_t* _dst, int _dstStride, int _width, int _height, int _bytesPerPixel, int _angle, bool _mirror);
+
+    // Plain scalar implementations. These are the fallback of the dispatcher and the reference for correctness tests.
+    namespace Reference
+    {
+        void RGB32ToRGB24(const uint8_t* _src, int _srcStride, uint8_t* _dst, int _dstStride, int _width, int _height, bool _flip);
+        void Y800ToRGB24(const uint8_t* _src, int _srcStride, uint8_t* _dst, int _dstStride, int _width, int _height, bool _flip);
+        void BayerToRGB24(const uint8_t* _src, int _srcStride, uint8_t* _dst, int _dstStride, int _width, int _height, BayerPattern _pattern, bool _flip);
+        void Rotate(const uint8_t* _src, int _srcStride, uint8_t* _dst, int _dstStride, int _width, int _height, int _bytesPerPixel, int _angle, bool _mirror);
+    }
+}}}}
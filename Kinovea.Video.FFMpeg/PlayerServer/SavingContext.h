@@ -41,6 +41,19 @@ namespace Kinovea { namespace Video { namespace FFMpeg
 		AVStream* pOutputDataStream;			// Output stream for meta data.
 		AVFrame* pInputFrame;					// The current incoming frame.
         SwsContext* pScalingContext;            // The scaling context for the RGB -> YUV color conversion.
+		array<IntPtr>^ convertedFrames;			// Converted frames (AVFrame*) handed to the encoder, used in rotation when pipelining.
+		int64_t iNextPts;						// Presentation time of the next frame sent to the encoder, in codec time base.
+		AVFrame* pYUV420Frame;					// Capture: converted frame, wraps pYUV420Buffer.
+		uint8_t* pYUV420Buffer;					// Capture: contiguous YUV420P buffer, also written as is when recording uncompressed.
+		int iYUV420BufferSize;
+		uint8_t* pEncodedBuffer;				// Capture: JPEG output buffer.
+		int iEncodedBufferSize;
+		array<IntPtr>^ encoderCodecContexts;	// Capture: one JPEG encoder (AVCodecContext*) per encoding thread.
+		array<IntPtr>^ encoderScalingContexts;	// Capture: one color conversion context (SwsContext*) per encoding thread.
+		int64_t iCurrentTimestamp;				// Capture: capture time of the frame being written, in microseconds. -1 if unknown.
+		int64_t iFirstTimestamp;				// Capture: capture time of the first frame of the file.
+		int64_t iLastPts;						// Capture: last timestamp written, in stream time base.
+		double fTimestampScale;					// Capture: capture time to file time ratio, for slow motion recording.
 		
 		double fPixelAspectRatio;				// Used to adapt pixel aspect ratio.
 		bool bInputWasMpeg2;					
@@ -53,6 +66,7 @@ namespace Kinovea { namespace Video { namespace FFMpeg
 		int iBitrate;				
 		Size outputSize;
         bool uncompressed;
+		Kinovea::Services::VideoEncodingProfile encodingProfile;
 
 		// Control
 		bool bEncoderOpened;
@@ -65,6 +79,11 @@ namespace Kinovea { namespace Video { namespace FFMpeg
 			fPixelAspectRatio = 1.0;		// Default aspect : square pixels.
 			outputSize = Size(720, 576);
             uncompressed = false;
+			iCurrentTimestamp = -1;
+			iFirstTimestamp = -1;
+			iLastPts = -1;
+			fTimestampScale = 1.0;
+			encodingProfile = Kinovea::Services::VideoEncodingProfile::Mpeg4Intra;
 		}
 	};
 }}}
@@ -26,12 +26,15 @@ using namespace System::Drawing::Drawing2D;
 using namespace System::IO;
 using namespace System::Runtime::InteropServices;
 
+using namespace Kinovea::Services;
 using namespace Kinovea::Video;
 using namespace Kinovea::Video::FFMpeg;
 
 VideoFileWriter::VideoFileWriter()
 {
     av_register_all();
+    m_BenchmarkStopwatch = gcnew Stopwatch();
+    m_BenchmarkCollections = gcnew array<int>(3);
 }
 
 VideoFileWriter::~VideoFileWriter()
@@ -49,6 +52,7 @@ SaveResult VideoFileWriter::Save(SavingSettings _settings, VideoInfo _info, Stri
     if(_frames == nullptr || _worker == nullptr)
         return SaveResult::UnknownError;
 
+    m_Metadata = _settings.Metadata;
     result = OpenSavingContext(	_settings.File, _info, _formatString, _settings.OutputFrameInterval);
 
     if(result != SaveResult::Success)
@@ -57,30 +61,61 @@ SaveResult VideoFileWriter::Save(SavingSettings _settings, VideoInfo _info, Stri
         return result;
     }
 
-    int64_t current = 0;
-    for each (Bitmap^ bmp in _frames)
+    // This thread converts the incoming bitmaps to YUV while a dedicated thread encodes and writes the previous ones.
+    // The converted frames circulate between the two, which bounds how far the conversion can run ahead.
+    // The bitmaps belong to the enumerator and are not used anymore once converted.
+    m_FreeFrames = gcnew BlockingCollection<IntPtr>();
+    m_EncodingQueue = gcnew BlockingCollection<IntPtr>();
+    m_EncodingFailed = false;
+    for each (IntPtr frame in m_SavingContext->convertedFrames)
+        m_FreeFrames->Add(frame);
+
+    Thread^ encodingThread = gcnew Thread(gcnew ThreadStart(this, &VideoFileWriter::EncodingWorker));
+    encodingThread->IsBackground = true;
+    encodingThread->Name = "Export encoding";
+    encodingThread->Start();
+
+    try
     {
-        if(_worker->CancellationPending)
+        int64_t current = 0;
+        for each (Bitmap^ bmp in _frames)
         {
-            delete bmp;
-            result = SaveResult::Cancelled;
-            break;
-        }
-        
-        result = SaveFrame(bmp);
-        if(result != SaveResult::Success)
-            log->Error("Frame not saved.");
-        
-        _worker->ReportProgress(current++, _settings.EstimatedTotal);
+            if(_worker->CancellationPending)
+            {
+                result = SaveResult::Cancelled;
+                break;
+            }
 
-        if(result != SaveResult::Success)
-        {
-            delete bmp;		
-            break;
+            if (m_EncodingFailed)
+            {
+                result = SaveResult::UnknownError;
+                break;
+            }
+            
+            IntPtr frame = m_FreeFrames->Take();
+            if (!ConvertFrame(m_SavingContext, bmp, (AVFrame*)frame.ToPointer()))
+            {
+                log->Error("Frame not saved.");
+                m_FreeFrames->Add(frame);
+                result = SaveResult::UnknownError;
+                break;
+            }
+
+            m_EncodingQueue->Add(frame);
+            
+            _worker->ReportProgress(current++, _settings.EstimatedTotal);
         }
     }
+    finally
+    {
+        // Also runs if the enumerator throws, so the encoding thread and the file are never left behind.
+        m_EncodingQueue->CompleteAdding();
+        encodingThread->Join();
+        CloseSavingContext(true);
+    }
 
-    CloseSavingContext(true);
+    if (result == SaveResult::Success && m_EncodingFailed)
+        result = SaveResult::UnknownError;
 
     if(result == SaveResult::Cancelled)
     {
@@ -149,7 +184,10 @@ SaveResult VideoFileWriter::OpenSavingContext(String^ _FilePath, VideoInfo _info
         m_SavingContext->fFramesInterval = _fFramesInterval;
     
     m_SavingContext->iBitrate = ComputeBitrate(m_SavingContext->outputSize, m_SavingContext->fFramesInterval);
+    m_SavingContext->encodingProfile = m_EncodingProfile;
     
+    ResetBenchmark();
+
     do
     {
         // 1. Muxer selection.
@@ -185,7 +223,7 @@ SaveResult VideoFileWriter::OpenSavingContext(String^ _FilePath, VideoInfo _info
         }
 
         // 4. Encoder selection
-        if ((m_SavingContext->pOutputCodec = avcodec_find_encoder(CODEC_ID_MPEG4)) == nullptr)
+        if (!SelectEncoder(m_SavingContext))
         {
             result = SaveResult::EncoderNotFound;
             log->Error("Encoder not found");
@@ -227,6 +265,10 @@ SaveResult VideoFileWriter::OpenSavingContext(String^ _FilePath, VideoInfo _info
         // 8. Associate encoder to stream.
         m_SavingContext->pOutputVideoStream->codec = m_SavingContext->pOutputCodecContext;
 
+        // 8b. Analysis stream, only if there is something to mux and the container supports it.
+        if (!String::IsNullOrEmpty(m_Metadata) && !SetupMetadataStream(m_SavingContext))
+            log->Error("Metadata stream not created, the analysis will not be saved in the file.");
+
         // 9. Open the file.
         averror = avio_open(&(m_SavingContext->pOutputFormatContext)->pb, m_SavingContext->pFilePath, AVIO_FLAG_WRITE);
         if (averror < 0) 
@@ -247,6 +289,13 @@ SaveResult VideoFileWriter::OpenSavingContext(String^ _FilePath, VideoInfo _info
             break;
         }
 
+        // 10b. The analysis is written as a single packet right after the header, so the reader finds it without scanning the file.
+        if (m_SavingContext->pOutputDataStream != nullptr && !WriteMetadata(m_SavingContext, m_Metadata))
+        {
+            result = SaveResult::MetadataNotWritten;
+            break;
+        }
+
         // 11. Allocate memory for the current incoming frame holder. (will be reused for each frame). 
         if ((m_SavingContext->pInputFrame = av_frame_alloc()) == nullptr) 
         {
@@ -254,6 +303,14 @@ SaveResult VideoFileWriter::OpenSavingContext(String^ _FilePath, VideoInfo _info
             log->Error("input frame not allocated");
             break;
         }
+
+        // 12. Allocate the conversion and encoding buffers, sized once for the whole export.
+        if (!AllocateFrameBuffers(m_SavingContext))
+        {
+            result = SaveResult::InputFrameNotAllocated;
+            log->Error("Frame buffers not allocated");
+            break;
+        }
     }
     while(false);
 
@@ -263,7 +320,7 @@ void VideoFileWriter::SanityCheck(AVFormatContext* s)
 {
     // Taken/Adapted from the real sanity check from utils.c av_write_header.
 
-    if (s->nb_streams != 1) 
+    if (s->nb_streams < 1) 
     {
         log->Error("Sanity check failed:no streams.");
         return;
@@ -306,7 +363,10 @@ SaveResult VideoFileWriter::CloseSavingContext(bool _bEncodingSuccess)
 
     if(_bEncodingSuccess)
     {
-        // Write file trailer.		
+        // Write the frames still held by the encoder, then the file trailer.
+        if (m_SavingContext->bEncoderOpened)
+            FlushEncoder(m_SavingContext);
+
         av_write_trailer(m_SavingContext->pOutputFormatContext);
     }
 
@@ -317,12 +377,16 @@ SaveResult VideoFileWriter::CloseSavingContext(bool _bEncodingSuccess)
         // Free the InputFrame holder
         av_free(m_SavingContext->pInputFrame);
     }
+
+    FreeFrameBuffers(m_SavingContext);
         
     Marshal::FreeHGlobal(safe_cast<IntPtr>(m_SavingContext->pFilePath));
+    m_Metadata = nullptr;
     
     // Stream release (equivalent to freeing pOutputCodec + pOutputVideoStream)
     for(int i = 0; i < (int)m_SavingContext->pOutputFormatContext->nb_streams; i++) 
     {
+        av_dict_free(&(m_SavingContext->pOutputFormatContext)->streams[i]->metadata);
         av_freep(&(m_SavingContext->pOutputFormatContext)->streams[i]->codec);
         av_freep(&(m_SavingContext->pOutputFormatContext)->streams[i]);
     }
@@ -335,6 +399,9 @@ SaveResult VideoFileWriter::CloseSavingContext(bool _bEncodingSuccess)
 
     // release pOutputFormat ?
 
+    if (m_Benchmark)
+        LogBenchmark();
+
     log->Debug("Saving video completed.");
 
     return result;
@@ -349,12 +416,19 @@ SaveResult VideoFileWriter::SaveFrame(Bitmap^ _image)
 {
     SaveResult result = SaveResult::Success;
 
-    if(!EncodeAndWriteVideoFrame(m_SavingContext, _image))
+    if (m_Benchmark)
+        m_BenchmarkStopwatch->Restart();
+
+    AVFrame* pFrame = (AVFrame*)m_SavingContext->convertedFrames[0].ToPointer();
+    if(!ConvertFrame(m_SavingContext, _image, pFrame) || !EncodeAndWriteVideoFrame(m_SavingContext, pFrame))
     {
         log->Error("error while writing output frame");
         result = SaveResult::UnknownError;
     }
 
+    if (m_Benchmark)
+        BenchmarkFrame(m_BenchmarkStopwatch->Elapsed.TotalMilliseconds);
+
     return result;
 }
 
@@ -395,6 +469,46 @@ bool VideoFileWriter::SetupMuxer(SavingContext^ _SavingContext)
     return bResult;
 }
 
+///<summary>
+/// VideoFileWriter::SelectEncoder
+/// Find the encoder for the requested profile, or fall back to MPEG-4 intra.
+///</summary>
+bool VideoFileWriter::SelectEncoder(SavingContext^ _SavingContext)
+{
+    VideoEncodingProfile profile = _SavingContext->encodingProfile;
+    AVCodec* codec = nullptr;
+    
+    switch (profile)
+    {
+    case VideoEncodingProfile::MjpegIntra:
+        codec = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+        break;
+    case VideoEncodingProfile::H264Intra:
+    case VideoEncodingProfile::H264ShortGop:
+        // libx264 needs even dimensions in 4:2:0.
+        if (_SavingContext->outputSize.Width % 2 == 0 && _SavingContext->outputSize.Height % 2 == 0)
+            codec = avcodec_find_encoder_by_name("libx264");
+        break;
+    case VideoEncodingProfile::Mpeg4Intra:
+    default:
+        codec = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+        break;
+    }
+
+    // avformat_query_codec returns a negative value when the muxer cannot tell, only reject explicit refusals.
+    bool supported = codec != nullptr && avformat_query_codec(_SavingContext->pOutputFormat, codec->id, FF_COMPLIANCE_NORMAL) != 0;
+    if (!supported && profile != VideoEncodingProfile::Mpeg4Intra)
+    {
+        log->WarnFormat("Encoding profile {0} not available for this file, using {1}.", profile, VideoEncodingProfile::Mpeg4Intra);
+        profile = VideoEncodingProfile::Mpeg4Intra;
+        codec = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+    }
+
+    _SavingContext->encodingProfile = profile;
+    _SavingContext->pOutputCodec = codec;
+    return codec != nullptr;
+}
+
 ///<summary>
 /// VideoFileWriter::SetupEncoder
 /// Configure the codec with default parameters.
@@ -430,10 +544,6 @@ bool VideoFileWriter::SetupEncoder(SavingContext^ _SavingContext)
     // Source: Avidemux.
     _SavingContext->pOutputCodecContext->bit_rate_tolerance = 8000000;
 
-    // Motion estimation algorithm used for video coding. 
-    // src: MEncoder.
-    _SavingContext->pOutputCodecContext->me_method = ME_EPZS;
-
     // Framerate - timebase.
     // Certains codecs (MPEG1/2) ne supportent qu'un certain nombre restreints de framerates.
     // src [kinovea]
@@ -479,11 +589,16 @@ bool VideoFileWriter::SetupEncoder(SavingContext^ _SavingContext)
     //				  Note: The output will be delayed by max_b_frames+1 relative to the input.
     //
     // [kinovea]	: Intra only so we can always access prev frame right away in the Player.
-    // [kinovea]	: Player doesn't support B-frames.
+    //				  The short GOP profile keeps a small fixed keyframe interval instead.
+    // [kinovea]	: Player doesn't support B-frames. No profile uses them.
     //-------------------------------------------------------------------------------------------
     _SavingContext->pOutputCodecContext->gop_size				= 0;	
     _SavingContext->pOutputCodecContext->max_b_frames			= 0;								
 
+    // Let the encoder use all cores, with frame or slice threading depending on what it supports.
+    _SavingContext->pOutputCodecContext->thread_count = 0;
+    _SavingContext->pOutputCodecContext->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
     // Pixel format
     // src:ffmpeg.
     _SavingContext->pOutputCodecContext->pix_fmt = AV_PIX_FMT_YUV420P; 	
@@ -509,11 +624,49 @@ bool VideoFileWriter::SetupEncoder(SavingContext^ _SavingContext)
     // These highly dynamic scenes are exactly what the encoding algorithms "optimize" out, 
     // so if we use "entertainment" parameters we end up with artefacts exactly at the worst moment.
     // In order to retain full details in dynamic scenes we must use the minimum quantization possible, at the expense of file size.
+    // H.264 uses a constant rate factor instead, with a low value that keeps fine details.
     //-------------------------------------------------------------
     
-    _SavingContext->pOutputCodecContext->flags |= CODEC_FLAG_QSCALE;	// Constant Quantization. (this means the bitrate parameter won't be used).
-    _SavingContext->pOutputCodecContext->qmin = 1;						// minimum quantizer (def:2)
-    _SavingContext->pOutputCodecContext->qmax = 1;						// maximum quantizer (def:31) (When using QSCALE flag only qmin is used anyway.)
+    AVCodecContext* pCodecContext = _SavingContext->pOutputCodecContext;
+    switch (_SavingContext->encodingProfile)
+    {
+    case VideoEncodingProfile::H264Intra:
+    case VideoEncodingProfile::H264ShortGop:
+    {
+        pCodecContext->bit_rate = 0;
+        av_opt_set(pCodecContext->priv_data, "preset", "veryfast", 0);
+        av_opt_set(pCodecContext->priv_data, "crf", "16", 0);
+
+        if (_SavingContext->encodingProfile == VideoEncodingProfile::H264Intra)
+        {
+            pCodecContext->gop_size = 1;
+        }
+        else
+        {
+            // Fixed keyframe interval (no scene cut detection) and closed GOPs,
+            // so any frame is reached by decoding from the previous keyframe.
+            pCodecContext->gop_size = H264ShortGopSize;
+            pCodecContext->keyint_min = H264ShortGopSize;
+            pCodecContext->scenechange_threshold = 0;
+            pCodecContext->flags |= CODEC_FLAG_CLOSED_GOP;
+        }
+        break;
+    }
+    case VideoEncodingProfile::MjpegIntra:
+    case VideoEncodingProfile::Mpeg4Intra:
+    default:
+    {
+        // Motion estimation algorithm used for video coding. 
+        // src: MEncoder.
+        pCodecContext->me_method = ME_EPZS;
+
+        int quantizer = _SavingContext->encodingProfile == VideoEncodingProfile::MjpegIntra ? MjpegQuantizer : Mpeg4Quantizer;
+        pCodecContext->flags |= CODEC_FLAG_QSCALE;	// Constant Quantization. (this means the bitrate parameter won't be used).
+        pCodecContext->qmin = quantizer;			// minimum quantizer (def:2)
+        pCodecContext->qmax = quantizer;			// maximum quantizer (def:31) (When using QSCALE flag only qmin is used anyway.)
+        break;
+    }
+    }
     
     // Sample Aspect Ratio.
     
@@ -580,19 +733,138 @@ bool VideoFileWriter::SetupEncoder(SavingContext^ _SavingContext)
 }
 
 ///<summary>
-/// VideoFileWriter::EncodeAndWriteVideoFrame
-/// Save a single frame in the video file. Takes a Bitmap as input.
+/// VideoFileWriter::SetupMetadataStream
+/// Add a text stream for the analysis. The reader recognizes it by its "XML" language tag.
 ///</summary>
-bool VideoFileWriter::EncodeAndWriteVideoFrame(SavingContext^ _SavingContext, Bitmap^ _InputBitmap)
+bool VideoFileWriter::SetupMetadataStream(SavingContext^ _SavingContext)
 {
-    bool written = false;
-    bool isBitmapLocked = false;
-    
-    AVFrame* pInputFrame = nullptr;
-    AVFrame* pYUV420Frame = nullptr;
-    uint8_t* pYUV420Buffer = nullptr;
-    uint8_t* pOutputBuffer = nullptr;
-    System::Drawing::Imaging::BitmapData^ bitmapData;
+    if (avformat_query_codec(_SavingContext->pOutputFormat, AV_CODEC_ID_TEXT, FF_COMPLIANCE_NORMAL) != 1)
+    {
+        log->DebugFormat("The {0} muxer does not support text streams.", gcnew String(_SavingContext->pOutputFormat->name));
+        return false;
+    }
+
+    AVStream* pStream = avformat_new_stream(_SavingContext->pOutputFormatContext, nullptr);
+    if (pStream == nullptr)
+        return false;
+
+    pStream->id = _SavingContext->pOutputFormatContext->nb_streams - 1;
+    pStream->codec->codec_type = AVMEDIA_TYPE_SUBTITLE;
+    pStream->codec->codec_id = AV_CODEC_ID_TEXT;
+    pStream->time_base.num = 1;
+    pStream->time_base.den = 1000;
+    pStream->codec->time_base = pStream->time_base;
+
+    if (_SavingContext->pOutputFormat->flags & AVFMT_GLOBALHEADER)
+        pStream->codec->flags |= CODEC_FLAG_GLOBAL_HEADER;
+
+    av_dict_set(&pStream->metadata, "language", "XML", 0);
+
+    _SavingContext->pOutputDataStream = pStream;
+    return true;
+}
+
+///<summary>
+/// VideoFileWriter::WriteMetadata
+/// Write the analysis as a single null terminated UTF-8 packet at the start of the timeline.
+///</summary>
+bool VideoFileWriter::WriteMetadata(SavingContext^ _SavingContext, String^ _metadata)
+{
+    array<System::Byte>^ bytes = Encoding::UTF8->GetBytes(_metadata);
+
+    AVPacket packet;
+    if (av_new_packet(&packet, bytes->Length + 1) < 0)
+    {
+        log->Error("Metadata packet not allocated");
+        return false;
+    }
+
+    Marshal::Copy(bytes, 0, IntPtr(packet.data), bytes->Length);
+    packet.data[bytes->Length] = 0;
+    packet.stream_index = _SavingContext->pOutputDataStream->index;
+    packet.pts = 0;
+    packet.dts = 0;
+    packet.duration = 1;
+    packet.flags |= AV_PKT_FLAG_KEY;
+
+    int averror = av_write_frame(_SavingContext->pOutputFormatContext, &packet);
+    av_free_packet(&packet);
+    if (averror < 0)
+    {
+        LogError("Metadata not written", averror);
+        return false;
+    }
+
+    log->DebugFormat("Analysis muxed in the file. {0} bytes.", bytes->Length);
+    return true;
+}
+
+///<summary>
+/// VideoFileWriter::AllocateFrameBuffers
+/// Allocate the converted frame and the encoded frame buffers. They are reused for every frame of the export.
+///</summary>
+bool VideoFileWriter::AllocateFrameBuffers(SavingContext^ _SavingContext)
+{
+    int outWidth = _SavingContext->outputSize.Width;
+    int outHeight = _SavingContext->outputSize.Height;
+
+    _SavingContext->convertedFrames = gcnew array<IntPtr>(ConvertedFramesCount);
+    for (int i = 0; i < ConvertedFramesCount; i++)
+    {
+        AVFrame* pFrame = av_frame_alloc();
+        if (pFrame == nullptr)
+        {
+            log->Error("output frame not allocated");
+            return false;
+        }
+
+        _SavingContext->convertedFrames[i] = IntPtr(pFrame);
+
+        pFrame->format = AV_PIX_FMT_YUV420P;
+        pFrame->width = outWidth;
+        pFrame->height = outHeight;
+        if (av_frame_get_buffer(pFrame, 32) < 0)
+        {
+            log->Error("YUV frame buffer not allocated");
+            return false;
+        }
+    }
+
+    _SavingContext->iNextPts = 0;
+
+    return true;
+}
+
+void VideoFileWriter::FreeFrameBuffers(SavingContext^ _SavingContext)
+{
+    if (_SavingContext->pScalingContext != nullptr)
+    {
+        sws_freeContext(_SavingContext->pScalingContext);
+        _SavingContext->pScalingContext = nullptr;
+    }
+
+    if (_SavingContext->convertedFrames != nullptr)
+    {
+        for (int i = 0; i < _SavingContext->convertedFrames->Length; i++)
+        {
+            AVFrame* pFrame = (AVFrame*)_SavingContext->convertedFrames[i].ToPointer();
+            if (pFrame != nullptr)
+                av_frame_free(&pFrame);
+        }
+
+        _SavingContext->convertedFrames = nullptr;
+    }
+}
+
+///<summary>
+/// VideoFileWriter::ConvertFrame
+/// Convert and resize the bitmap into the passed YUV frame, ready for encoding.
+/// Only uses the buffers of the saving context, nothing is allocated per frame unless the encoder still holds the buffer.
+///</summary>
+bool VideoFileWriter::ConvertFrame(SavingContext^ _SavingContext, Bitmap^ _InputBitmap, AVFrame* _pOutputFrame)
+{
+    bool converted = false;
+    System::Drawing::Imaging::BitmapData^ bitmapData = nullptr;
 
     AVPixelFormat pixelFormatInput = AV_PIX_FMT_BGRA;
     if(_InputBitmap->PixelFormat == Imaging::PixelFormat::Format32bppPArgb || _InputBitmap->PixelFormat == Imaging::PixelFormat::Format32bppArgb)
@@ -602,150 +874,227 @@ bool VideoFileWriter::EncodeAndWriteVideoFrame(SavingContext^ _SavingContext, Bi
     else if(_InputBitmap->PixelFormat == Imaging::PixelFormat::Format8bppIndexed)
         pixelFormatInput = PIX_FMT_BGR8; // AV_PIX_FMT_GRAY8 ?
     
-    do
+    int inWidth = _InputBitmap->Width;
+    int inHeight = _InputBitmap->Height;
+    int outWidth = _SavingContext->outputSize.Width;
+    int outHeight = _SavingContext->outputSize.Height;
+
+    // The scaling context is only rebuilt if the input size or format changes, which doesn't happen during a normal export.
+    _SavingContext->pScalingContext = sws_getCachedContext(_SavingContext->pScalingContext,
+        inWidth, inHeight, pixelFormatInput, 
+        outWidth, outHeight, AV_PIX_FMT_YUV420P, SWS_BICUBIC,
+        NULL, NULL, NULL);
+
+    if (_SavingContext->pScalingContext == nullptr)
     {
-        int inWidth = _InputBitmap->Width;
-        int inHeight = _InputBitmap->Height;
-        int outWidth = _SavingContext->outputSize.Width;
-        int outHeight = _SavingContext->outputSize.Height;
+        log->Error("scaling context not created");
+        return false;
+    }
 
-        // Allocate the input frame that will wrap the bitmap content.
-        if ((pInputFrame = av_frame_alloc()) == nullptr) 
-        {
-            log->Error("input frame not allocated");
-            break;
-        }
-        
-        // Associate the Bitmap data to the AVFrame
+    do
+    {
+        // Associate the Bitmap data to the input frame.
         Rectangle rect = Rectangle(0, 0, inWidth, inHeight);
         bitmapData = _InputBitmap->LockBits(rect, Imaging::ImageLockMode::ReadOnly, _InputBitmap->PixelFormat);
-        isBitmapLocked = true;
         
-        pin_ptr<uint8_t> pRGBBuffer = (uint8_t*)bitmapData->Scan0.ToPointer();
-        avpicture_fill((AVPicture *)pInputFrame, pRGBBuffer, pixelFormatInput, inWidth, inHeight);
+        AVFrame* pInputFrame = _SavingContext->pInputFrame;
+        avpicture_fill((AVPicture *)pInputFrame, (uint8_t*)bitmapData->Scan0.ToPointer(), pixelFormatInput, inWidth, inHeight);
+        pInputFrame->linesize[0] = bitmapData->Stride;
         
-        // -> At that point, pInputFrame holds a non compressed bitmap in the input pixel format (ex: RGB24).
-        // This bitmap is still at the decoding size.
-
-        // Prepare the resized / color space converted frame.
-        if ((pYUV420Frame = av_frame_alloc()) == nullptr) 
+        // With frame threading the encoder only keeps a reference to the frames it is still working on.
+        // Make sure we own the buffer before overwriting it, this reallocates only if a worker still holds it.
+        if (av_frame_make_writable(_pOutputFrame) < 0)
         {
-            log->Error("output frame not allocated");
+            log->Error("output frame not writable");
             break;
         }
-         
-        int yuvBufferSize = avpicture_get_size(AV_PIX_FMT_YUV420P, outWidth, outHeight);
-        pYUV420Buffer = (uint8_t*)av_malloc(yuvBufferSize);
 
-        if (pYUV420Buffer == nullptr) 
-        {
-            log->Error("YUV frame buffer not allocated");
-            break;
-        }
-
-        avpicture_fill((AVPicture *)pYUV420Frame, pYUV420Buffer, AV_PIX_FMT_YUV420P, outWidth, outHeight);
-        
         // Perform the color space conversion and resizing.
-        SwsContext* scalingContext = sws_getContext(
-            inWidth, inHeight, pixelFormatInput, 
-            outWidth, outHeight, AV_PIX_FMT_YUV420P, SWS_BICUBIC,
-            NULL, NULL, NULL);
-
-        if (sws_scale(scalingContext, pInputFrame->data, pInputFrame->linesize, 0, inHeight, pYUV420Frame->data, pYUV420Frame->linesize) < 0) 
+        if (sws_scale(_SavingContext->pScalingContext, pInputFrame->data, pInputFrame->linesize, 0, inHeight, _pOutputFrame->data, _pOutputFrame->linesize) < 0) 
         {
             log->Error("scaling failed");
-            sws_freeContext(scalingContext);
             break;
         }
 
-        sws_freeContext(scalingContext);
-
-        // Allocate encoded frame buffer.
-        // Assumes compressed size is always smaller than uncompressed. (Not technically true).
-        int encodedBufferSize = outWidth * outHeight * 4;
-        pOutputBuffer = (uint8_t*)av_malloc(encodedBufferSize);
-        
-        if (pOutputBuffer == nullptr) 
-        {
-            log->Error("output video buffer not allocated");
-            break;
-        }
-        
-        // Actual encoding step.
-        // AccessViolationException ? => memalign issue, requires recompiling libavc with the correct gcc.
-        int encodedSize = avcodec_encode_video(_SavingContext->pOutputCodecContext, pOutputBuffer, encodedBufferSize, pYUV420Frame);
-        
-        // Write the video packet in the output.
-        if (encodedSize > 0)
-        {   
-            if (!WriteFrame(encodedSize, _SavingContext, pOutputBuffer, true))
-            {
-                log->Error("problem while writing frame to file");
-                break;
-            }
-            
-            written = true;
-        }
+        converted = true;
     }
     while(false);
 
-    if (pOutputBuffer)
-        av_free(pOutputBuffer);
+    if(bitmapData != nullptr)
+        _InputBitmap->UnlockBits(bitmapData);
 
-    if (pInputFrame != nullptr)
-        av_free(pInputFrame);
+    return converted;
+}
 
-    if(isBitmapLocked)
-        _InputBitmap->UnlockBits(bitmapData);
+///<summary>
+/// VideoFileWriter::EncodeAndWriteVideoFrame
+/// Send a converted frame to the encoder and write the packet it outputs, if any.
+/// Threaded and lookahead encoders hold a few frames, their packets come out with later frames or when flushing.
+///</summary>
+bool VideoFileWriter::EncodeAndWriteVideoFrame(SavingContext^ _SavingContext, AVFrame* _pFrame)
+{
+    // One tick of the codec time base per frame.
+    _pFrame->pts = _SavingContext->iNextPts++;
 
-    if (pYUV420Frame != nullptr)
-        av_free(pYUV420Frame);
+    AVPacket packet;
+    av_init_packet(&packet);
+    packet.data = nullptr;
+    packet.size = 0;
 
-    if (pYUV420Buffer != nullptr)
-        av_free(pYUV420Buffer);
+    int gotPacket = 0;
+    int averror = avcodec_encode_video2(_SavingContext->pOutputCodecContext, &packet, _pFrame, &gotPacket);
+    if (averror < 0)
+    {
+        LogError("Frame not encoded", averror);
+        return false;
+    }
 
-    // (Temporary) fix to OOM error that sometimes happen with very large image size.
-    GC::Collect();
+    if (!gotPacket)
+        return true;
+
+    bool written = WriteFrame(_SavingContext, &packet);
+    av_packet_unref(&packet);
+    
+    if (!written)
+        log->Error("problem while writing frame to file");
 
     return written;
 }
 
 ///<summary>
-/// VideoFileWriter::WriteBuffer
-/// Commit a single frame in the video file.
+/// VideoFileWriter::FlushEncoder
+/// Drain the encoder of the frames it still holds and write them.
 ///</summary>
-bool VideoFileWriter::WriteFrame(int _iEncodedSize, SavingContext^ _SavingContext, uint8_t* _pOutputVideoBuffer, bool bForceKeyframe)
+bool VideoFileWriter::FlushEncoder(SavingContext^ _SavingContext)
 {
-    if (_iEncodedSize > 0) 
+    while (true)
     {
-        AVPacket OutputPacket;
-        av_init_packet(&OutputPacket);
+        AVPacket packet;
+        av_init_packet(&packet);
+        packet.data = nullptr;
+        packet.size = 0;
 
-        // Compute packet position.
-        OutputPacket.pts = av_rescale_q(_SavingContext->pOutputCodecContext->coded_frame->pts, _SavingContext->pOutputCodecContext->time_base, _SavingContext->pOutputVideoStream->time_base);
+        int gotPacket = 0;
+        int averror = avcodec_encode_video2(_SavingContext->pOutputCodecContext, &packet, nullptr, &gotPacket);
+        if (averror < 0)
+        {
+            LogError("Encoder not flushed", averror);
+            return false;
+        }
 
-        // Flag Keyframes as such.
-        if(_SavingContext->pOutputCodecContext->coded_frame->key_frame || bForceKeyframe)
+        if (!gotPacket)
+            return true;
+
+        bool written = WriteFrame(_SavingContext, &packet);
+        av_packet_unref(&packet);
+
+        if (!written)
+            return false;
+    }
+}
+
+///<summary>
+/// VideoFileWriter::EncodingWorker
+/// Encoding stage of the export pipeline. Encodes the converted frames in order and gives them back for conversion.
+///</summary>
+void VideoFileWriter::EncodingWorker()
+{
+    for each (IntPtr frame in m_EncodingQueue->GetConsumingEnumerable())
+    {
+        // After a failure, keep draining the queue so the converting thread is never blocked.
+        if (!m_EncodingFailed)
         {
-            OutputPacket.flags |= AV_PKT_FLAG_KEY;
+            if (m_Benchmark)
+                m_BenchmarkStopwatch->Restart();
+
+            if (!EncodeAndWriteVideoFrame(m_SavingContext, (AVFrame*)frame.ToPointer()))
+            {
+                log->Error("error while writing output frame");
+                m_EncodingFailed = true;
+            }
+            else if (m_Benchmark)
+            {
+                BenchmarkFrame(m_BenchmarkStopwatch->Elapsed.TotalMilliseconds);
+            }
         }
 
-        // Associate various buffers before the commit.
-        OutputPacket.stream_index = _SavingContext->pOutputVideoStream->index;
-        OutputPacket.data= _pOutputVideoBuffer;
-        OutputPacket.size= _iEncodedSize;
+        m_FreeFrames->Add(frame);
+    }
+}
 
-        // Commit the packet to the file.
-        int iWriteRes = av_write_frame(_SavingContext->pOutputFormatContext, &OutputPacket);
-    } 
-    else
+///<summary>
+/// VideoFileWriter::WriteFrame
+/// Commit a single encoded packet in the video file.
+///</summary>
+bool VideoFileWriter::WriteFrame(SavingContext^ _SavingContext, AVPacket* _pPacket)
+{
+    // The encoder sets the timestamps and the keyframe flag, we only move them to the stream time base.
+    av_packet_rescale_ts(_pPacket, _SavingContext->pOutputCodecContext->time_base, _SavingContext->pOutputVideoStream->time_base);
+    _pPacket->stream_index = _SavingContext->pOutputVideoStream->index;
+
+    int averror = av_write_frame(_SavingContext->pOutputFormatContext, _pPacket);
+    if (averror < 0)
     {
-        log->Error("encoded size not positive");
+        LogError("Packet not written", averror);
+        return false;
     }
 
     return true;
 }
 
+void VideoFileWriter::ResetBenchmark()
+{
+    m_BenchmarkFrames = 0;
+    m_BenchmarkTotal = 0;
+    m_BenchmarkMin = Double::MaxValue;
+    m_BenchmarkMax = 0;
+}
+
+void VideoFileWriter::BenchmarkFrame(double _elapsed)
+{
+    // The first frames include the creation of the scaling context and the encoder warm up, they are not counted.
+    m_BenchmarkFrames++;
+    if (m_BenchmarkFrames == BenchmarkWarmupFrames)
+    {
+        for (int i = 0; i < m_BenchmarkCollections->Length; i++)
+            m_BenchmarkCollections[i] = GC::CollectionCount(i);
+
+        m_BenchmarkAllocated = AppDomain::MonitoringIsEnabled ? AppDomain::CurrentDomain->MonitoringTotalAllocatedMemorySize : 0;
+        return;
+    }
+
+    if (m_BenchmarkFrames < BenchmarkWarmupFrames)
+        return;
+
+    m_BenchmarkTotal += _elapsed;
+    m_BenchmarkMin = Math::Min(m_BenchmarkMin, _elapsed);
+    m_BenchmarkMax = Math::Max(m_BenchmarkMax, _elapsed);
+}
+
+void VideoFileWriter::LogBenchmark()
+{
+    int64_t frames = m_BenchmarkFrames - BenchmarkWarmupFrames;
+    if (frames <= 0)
+    {
+        log->DebugFormat("Export benchmark: not enough frames ({0}).", m_BenchmarkFrames);
+        return;
+    }
+
+    log->DebugFormat("Export benchmark: {0} frames, average:{1:0.000} ms, min:{2:0.000} ms, max:{3:0.000} ms.",
+        frames, m_BenchmarkTotal / frames, m_BenchmarkMin, m_BenchmarkMax);
+
+    log->DebugFormat("Export benchmark: GC collections gen0:{0}, gen1:{1}, gen2:{2}.",
+        GC::CollectionCount(0) - m_BenchmarkCollections[0], 
+        GC::CollectionCount(1) - m_BenchmarkCollections[1], 
+        GC::CollectionCount(2) - m_BenchmarkCollections[2]);
+
+    if (AppDomain::MonitoringIsEnabled)
+    {
+        int64_t allocated = AppDomain::CurrentDomain->MonitoringTotalAllocatedMemorySize - m_BenchmarkAllocated;
+        log->DebugFormat("Export benchmark: {0} managed bytes allocated per frame.", allocated / frames);
+    }
+}
+
 void VideoFileWriter::LogError(String^ context, int error)
 {
     char errbuf[256];
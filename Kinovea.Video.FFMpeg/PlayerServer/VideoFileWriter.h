@@ -38,11 +38,13 @@ extern "C"
 #include <avcodec.h>
 #include <avstring.h>
 #include <swscale.h> 
+#include <opt.h>
 }
 
 #include "SavingContext.h"
 
 using namespace System;
+using namespace System::Collections::Concurrent;
 using namespace System::Collections::Generic;				
 using namespace System::ComponentModel;
 using namespace System::Diagnostics;
@@ -72,6 +74,23 @@ namespace Kinovea { namespace Video { namespace FFMpeg
             }
         }
 
+        /// <summary>
+        /// When set, measure the steady-state encoding time and allocations per frame and log them when the context is closed.
+        /// </summary>
+        property bool Benchmark {
+            bool get() { return m_Benchmark; }
+            void set(bool value) { m_Benchmark = value; }
+        }
+
+        /// <summary>
+        /// Codec configuration used for the next saving context.
+        /// Falls back to MPEG-4 intra if the encoder is not available or not supported by the container.
+        /// </summary>
+        property Kinovea::Services::VideoEncodingProfile EncodingProfile {
+            Kinovea::Services::VideoEncodingProfile get() { return m_EncodingProfile; }
+            void set(Kinovea::Services::VideoEncodingProfile value) { m_EncodingProfile = value; }
+        }
+
     // Public Methods
     public:
         SaveResult Save(SavingSettings _settings,  VideoInfo _info, String^ _formatString, IEnumerable<Bitmap^>^ _frames, BackgroundWorker^ _worker);
@@ -83,18 +102,54 @@ namespace Kinovea { namespace Video { namespace FFMpeg
     private:
         double ComputeBitrate(Size outputSize, double frameInterval);
         bool SetupMuxer(SavingContext^ _SavingContext);
+        bool SelectEncoder(SavingContext^ _SavingContext);
         bool SetupEncoder(SavingContext^ _SavingContext);
+        bool SetupMetadataStream(SavingContext^ _SavingContext);
+        bool WriteMetadata(SavingContext^ _SavingContext, String^ _metadata);
+        bool AllocateFrameBuffers(SavingContext^ _SavingContext);
+        void FreeFrameBuffers(SavingContext^ _SavingContext);
         
-        bool EncodeAndWriteVideoFrame(SavingContext^ _SavingContext, Bitmap^ _InputBitmap);
-        bool WriteFrame(int _iEncodedSize, SavingContext^ _SavingContext, uint8_t* _pOutputVideoBuffer, bool _bForceKeyframe);
+        bool ConvertFrame(SavingContext^ _SavingContext, Bitmap^ _InputBitmap, AVFrame* _pOutputFrame);
+        bool EncodeAndWriteVideoFrame(SavingContext^ _SavingContext, AVFrame* _pFrame);
+        bool FlushEncoder(SavingContext^ _SavingContext);
+        void EncodingWorker();
+        bool WriteFrame(SavingContext^ _SavingContext, AVPacket* _pPacket);
         void SanityCheck(AVFormatContext* s);
         void LogError(String^ context, int ffmpegError);
         static int GreatestCommonDenominator(int a, int b);
+        
+        void ResetBenchmark();
+        void BenchmarkFrame(double _elapsed);
+        void LogBenchmark();
     
     // Members
     private :
         static log4net::ILog^ log = log4net::LogManager::GetLogger(MethodBase::GetCurrentMethod()->DeclaringType);
         SavingContext^ m_SavingContext;
         String^ m_Filename;
+        String^ m_Metadata;
+        Kinovea::Services::VideoEncodingProfile m_EncodingProfile;
+
+        // Export pipeline.
+        BlockingCollection<IntPtr>^ m_FreeFrames;
+        BlockingCollection<IntPtr>^ m_EncodingQueue;
+        volatile bool m_EncodingFailed;
+        static const int ConvertedFramesCount = 4;
+
+        // Encoding profiles.
+        static const int Mpeg4Quantizer = 1;
+        static const int MjpegQuantizer = 2;
+        static const int H264ShortGopSize = 10;
+
+        // Benchmark.
+        bool m_Benchmark;
+        Stopwatch^ m_BenchmarkStopwatch;
+        int64_t m_BenchmarkFrames;
+        double m_BenchmarkTotal;
+        double m_BenchmarkMin;
+        double m_BenchmarkMax;
+        array<int>^ m_BenchmarkCollections;
+        int64_t m_BenchmarkAllocated;
+        static const int BenchmarkWarmupFrames = 10;
     };
 }}}
@@ -38,7 +38,10 @@ along with Kinovea. If not, see http://www.gnu.org/licenses/.
 // The native buffer will *not* be automatically free'd when calling Bitmap->Dispose().
 // This means we need to track the pointer and deallocate manually.
 // To achieve that, we use the Tag property of the Bitmap to store an IntPtr wrapping the pointer to the buffer.
-// When asked to release this specific Bitmap, we unwrap the IntPtr to the pointer, and call delete.
+// When asked to release this specific Bitmap, we unwrap the IntPtr to the pointer, and give the buffer back to the pool.
+// The buffers are leased from a pool owned by the reader to avoid allocating a large buffer for every frame.
+// When the decoded image doesn't need any conversion (uncompressed files), the Bitmap wraps the data of a reference-counted 
+// AVFrame instead, and the Tag holds a DecodedFrameReference. Releasing the Bitmap frees that AVFrame reference.
 //
 // Note: Calling av_free(AVFrame*) does not deallocate the data buffer either,
 // so AVFrame variables can be local to the function, it won't kill the Bitmaps.
@@ -54,8 +57,10 @@ extern "C" {
 #include <avfilter.h>
 #include <avfiltergraph.h>
 #include <buffersink.h>
+#include <buffersrc.h>
 #include <avformat.h>
 #include <avutil.h>
+#include <pixdesc.h>
 #include <postprocess.h>
 #include <swresample.h>
 #include <swscale.h>
@@ -64,6 +69,11 @@ extern "C" {
 #include "ReadResult.h"
 #include "TimestampInfo.h"
 #include "SavingContext.h"
+#include "FrameBufferPool.h"
+#include "DecodingThreading.h"
+#include "DecodingOutputFormat.h"
+#include "DecodedFrameReference.h"
+#include "KeyframeIndex.h"
 
 using namespace System;
 using namespace System::ComponentModel;
@@ -120,6 +130,8 @@ namespace Kinovea { namespace Video { namespace FFMpeg
             VideoSection get() override {
                 if(m_DecodingMode == VideoDecodingMode::PreBuffering)
                     return m_PreBuffer->Segment;
+                else if(m_DecodingMode == VideoDecodingMode::ReverseBuffering)
+                    return m_ReverseBuffer->Segment;
                 else 
                     return VideoSection::Empty; 
             }
@@ -140,6 +152,22 @@ namespace Kinovea { namespace Video { namespace FFMpeg
             }
         }
 
+    // Properties (FFMpeg specific). Threading and output options are applied the next time a file is opened.
+    public:
+        property DecodingThreading Threading {
+            DecodingThreading get() { return m_Threading; }
+            void set(DecodingThreading value) { m_Threading = value; }
+        }
+        property int ThreadCount {
+            // 0 means automatic, based on the number of cores.
+            int get() { return m_ThreadCount; }
+            void set(int value) { m_ThreadCount = value; }
+        }
+        property DecodingOutputFormat OutputFormat {
+            DecodingOutputFormat get() { return m_OutputFormat; }
+            void set(DecodingOutputFormat value) { m_OutputFormat = value; }
+        }
+
     // Public Methods (VideoReader subclassing).
     public:
         virtual OpenVideoResult Open(String^ _filePath) override;
@@ -155,6 +183,8 @@ namespace Kinovea { namespace Video { namespace FFMpeg
         virtual bool ChangeDeinterlace(bool _deint) override;
         virtual bool ChangeDecodingSize(Size _size) override;
         virtual void DisableCustomDecodingSize() override;
+        virtual bool CanRemux(VideoSection _section, String^ _formatString) override;
+        virtual SaveResult Remux(SavingSettings _settings, String^ _formatString, BackgroundWorker^ _worker) override;
         virtual void BeforePlayloop() override;
         virtual void BeforeFrameEnumeration() override;
         virtual void AfterFrameEnumeration() override;
@@ -177,6 +207,7 @@ namespace Kinovea { namespace Video { namespace FFMpeg
         bool m_bIsVeryShort;
         bool m_bFirstFrameRead;
         VideoInfo m_VideoInfo;
+        ImageRotation m_FileRotation;
         long m_timestampOffset = 0;
         VideoSection m_WorkingZone;
         Object^ m_Locker;
@@ -190,23 +221,58 @@ namespace Kinovea { namespace Video { namespace FFMpeg
         IVideoFramesContainer^ m_FramesContainer;
         SingleFrame^ m_SingleFrameContainer;
         PreBuffer^ m_PreBuffer;
+        ReverseBuffer^ m_ReverseBuffer;
         Cache^ m_Cache;
+        FrameBufferPool^ m_FrameBufferPool;
         
         
         // FFMpeg specifics
         int m_iVideoStream;
         int m_iAudioStream;
         int m_iMetadataStream;
+        String^ m_Metadata;
+        DecodingThreading m_Threading;
+        int m_ThreadCount;
+        DecodingOutputFormat m_OutputFormat;
         AVFormatContext* m_pFormatCtx;
         AVCodecContext* m_pCodecCtx;
         TimestampInfo m_TimestampInfo;
-        static const enum AVPixelFormat m_PixelFormatFFmpeg = AV_PIX_FMT_BGRA;
+        AVPixelFormat m_PixelFormatFFmpeg;
+        System::Drawing::Imaging::PixelFormat m_PixelFormatBitmap;
+        int m_BytesPerPixel;
+
+        // Scaling context cache. Only rebuilt when one of the inputs of the conversion changes.
+        SwsContext* m_pSwsContext;
+        int m_SwsSourceWidth;
+        int m_SwsSourceHeight;
+        AVPixelFormat m_SwsSourceFormat;
+        int m_SwsOutputWidth;
+        int m_SwsOutputHeight;
+        AVPixelFormat m_SwsOutputFormat;
+        int m_SwsCacheHits;
+        int m_SwsCacheRebuilds;
         static const int DecodingQuality = SWS_FAST_BILINEAR;
 
+        // Deinterlacing filter graph. Only rebuilt when the format of the decoded frames changes.
+        AVFilterGraph* m_pDeinterlacingGraph;
+        AVFilterContext* m_pBufferSourceCtx;
+        AVFilterContext* m_pBufferSinkCtx;
+        AVFrame* m_pDeinterlacingInputFrame;
+        AVFrame* m_pDeinterlacedFrame;
+        int m_DeinterlacingWidth;
+        int m_DeinterlacingHeight;
+        AVPixelFormat m_DeinterlacingFormat;
+        static const int MaxDecodingThreads = 16;
+        static const int MaxReverseBufferingJump = 10;
+        static const int ReverseBufferingMemory = 256; // MB, for all the chunks held by the reverse buffer.
+
         // Others
         bool m_WasPrebuffering;
         LoopWatcher^ m_LoopWatcher;
         Thread^ m_PreBufferingThread;
+        KeyframeIndex^ m_KeyframeIndex;
+        Thread^ m_IndexingThread;
+        ThreadCanceler^ m_IndexingThreadCanceler;
         static log4net::ILog^ log = log4net::LogManager::GetLogger(MethodBase::GetCurrentMethod()->DeclaringType);
 
     // Private methods
@@ -214,15 +280,33 @@ namespace Kinovea { namespace Video { namespace FFMpeg
 
         void DataInit();
         OpenVideoResult Load(String^ _filePath, bool _forSummary);
+        void ConfigureThreading(AVCodecContext* _pCodecCtx, AVCodec* _pCodec, bool _forSummary);
         ReadResult ReadFrame(int64_t _iTimeStampToSeekTo, int _iFramesToDecode, bool _approximate);
         int SeekTo(int64_t _target);
+        bool CanDecodeForwardTo(int64_t _target);
         bool RescaleAndConvert(AVFrame* _pOutputFrame, AVFrame* _pInputFrame, int _OutputWidth, int _OutputHeight, int _OutputFmt, bool _bDeinterlace);
-        static void DisposeFrame(VideoFrame^ _frame);
+        AVPixelFormat GetSourcePixelFormat();
+        SwsContext* GetScalingContext(AVPixelFormat _srcFormat, int _OutputWidth, int _OutputHeight, AVPixelFormat _OutputFmt);
+        void ReleaseScalingContext();
+        AVFrame* Deinterlace(AVFrame* _pInputFrame);
+        bool GetDeinterlacingGraph(int _width, int _height, AVPixelFormat _format);
+        void ReleaseDeinterlacingGraph();
+        void ConfigureOutputFormat(bool _forSummary);
+        bool CanWrapDecodedFrame(AVFrame* _pFrame);
+        ReadResult WrapDecodedFrame(AVFrame* _pFrame);
+        static void SetGrayscalePalette(Bitmap^ _bitmap);
+        static void RotateImage(uint8_t* _pDst, uint8_t* _pSrc, int _width, int _height, int _srcStride, int _bytesPerPixel, ImageRotation _rotation);
+        void DisposeFrame(VideoFrame^ _frame);
         static int GetStreamIndex(AVFormatContext* _pFormatCtx, int _iCodecType);
         void UpdateReferenceSizes(ImageAspectRatio _ratio, bool verbose);
         Size FixSize(Size _size, bool sideways);
         void ResetDecodingSize();
         void PreBufferingWorker(Object^ _canceler);
+        void ReverseBufferingWorker(Object^ _canceler);
+        bool ReadChunk(int64_t _limit, ThreadCanceler^ _canceler);
+        bool IsShortBackwardJump(int64_t _timestamp);
+        int GetReverseChunkFrames();
+        void ExitReverseBuffering();
         bool WorkingZoneFitsInMemory(VideoSection _newZone, int _maxMemory);
         bool ReadMany(BackgroundWorker^ _bgWorker, VideoSection _section, bool _prepend);
         void SwitchDecodingMode(VideoDecodingMode _mode);
@@ -230,6 +314,9 @@ namespace Kinovea { namespace Video { namespace FFMpeg
         void ImportWorkingZoneToCache(System::Object^ sender,DoWorkEventArgs^ e);
         void StartPreBuffering();
         void StopPreBuffering();
+        void StartIndexing();
+        void StopIndexing();
+        void IndexingWorker(Object^ _canceler);
 
         void DumpInfo();
         static void DumpStreamsInfos(AVFormatContext* _pFormatCtx);
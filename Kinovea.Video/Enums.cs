@@ -40,7 +40,8 @@ namespace Kinovea.Video
         CanChangeDecodingSize = 256,
         CanScaleIndefinitely = 512,
         CanChangeImageRotation = 1024,
-        CanChangeDemosaicing = 2048
+        CanChangeDemosaicing = 2048,
+        CanReverseBuffer = 4096
     }
     
     /// <summary>
@@ -51,7 +52,8 @@ namespace Kinovea.Video
         NotInitialized, // The video is just opening or has closed and the reader is not fully initialized.
         OnDemand,       // each frame is decoded on the fly when the player needs it.
         PreBuffering,   // frames are decoded in a separate thread and pushed to a small buffer.
-        Caching         // All the frames of the working zone have been loaded to a large buffer.
+        Caching,        // All the frames of the working zone have been loaded to a large buffer.
+        ReverseBuffering // frames are decoded GOP by GOP in a separate thread and served in reverse order.
     }
 
     public enum OpenVideoResult
@@ -0,0 +1,303 @@
+﻿#region License
+/*
+Copyright © Joan Charmant 2021.
+jcharmant@gmail.com 
+ 
+This file is part of Kinovea.
+
+Kinovea is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 
+as published by the Free Software Foundation.
+
+Kinovea is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Kinovea. If not, see http://www.gnu.org/licenses/.
+*/
+#endregion
+using System;
+using System.Collections.Generic;
+using System.Threading;
+
+namespace Kinovea.Video
+{
+    /// <summary>
+    /// A buffer to serve frames in reverse order.
+    /// Frames are decoded forward by chunks starting at a keyframe (GOP) and the playhead moves backwards through them.
+    /// </summary>
+    /// <remarks>
+    /// Naming:
+    /// - Chunk: a contiguous run of frames decoded in one go, at most one GOP.
+    /// - Pending chunk: the chunk currently being decoded, not yet visible.
+    ///
+    /// The decoding thread prepends chunks, the UI thread moves the playhead towards the start.
+    /// At most one chunk earlier than the current one is prefetched, 
+    /// and at most one chunk later than the current one is kept, the others are disposed.
+    /// The chunk size is set by the reader from its memory budget. GOPs longer than that are split: 
+    /// only the last frames of the GOP are kept in the chunk and the earlier part is decoded again in the next chunk.
+    ///
+    /// Thread safety: all accesses to the frame lists are done inside the lock.
+    /// </remarks>
+    public class ReverseBuffer : IVideoFramesContainer
+    {
+        #region Properties
+        public VideoFrame CurrentFrame {
+            get { return m_Current; }
+        }
+        public VideoSection Segment {
+            get { lock (m_Locker) return m_Segment; }
+        }
+        #endregion
+
+        #region Members
+        private List<VideoFrame> m_Frames = new List<VideoFrame>();
+        private List<int> m_ChunkSizes = new List<int>();
+        private List<VideoFrame> m_Pending = new List<VideoFrame>();
+        private VideoSection m_Segment = VideoSection.Empty;
+        private int m_CurrentIndex = -1;
+        private VideoFrame m_Current;
+        private int m_MaxChunkFrames = DefaultChunkFrames;
+        private VideoFrameDisposer m_DisposeBitmap;
+        private readonly object m_Locker = new object();
+        private const int DefaultChunkFrames = 12;
+        private static readonly log4net.ILog log = log4net.LogManager.GetLogger(System.Reflection.MethodBase.GetCurrentMethod().DeclaringType);
+        #endregion
+
+        #region Construction
+        public ReverseBuffer() { }
+        public ReverseBuffer(VideoFrameDisposer _disposeDelegate)
+        {
+            m_DisposeBitmap = _disposeDelegate;
+        }
+        #endregion
+
+        #region Public methods
+        /// <summary>
+        /// Set the maximum number of frames kept per chunk. Takes effect on the next chunk.
+        /// </summary>
+        public void SetMaxChunkFrames(int _frames)
+        {
+            lock (m_Locker)
+                m_MaxChunkFrames = Math.Max(1, _frames);
+        }
+
+        /// <summary>
+        /// Add a frame to the pending chunk. Frames must be added in increasing timestamp order.
+        /// </summary>
+        public void Add(VideoFrame _frame)
+        {
+            lock (m_Locker)
+            {
+                m_Pending.Add(_frame);
+
+                // Only keep the end of the chunk.
+                if (m_Pending.Count > m_MaxChunkFrames)
+                {
+                    DisposeFrame(m_Pending[0]);
+                    m_Pending.RemoveAt(0);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Start a new chunk, discarding any frame left from an incomplete one.
+        /// </summary>
+        public void BeginChunk()
+        {
+            lock (m_Locker)
+                ClearPending();
+        }
+
+        /// <summary>
+        /// Make the pending chunk visible. Frames at or after the limit, or overlapping with the buffered frames, are discarded.
+        /// Returns the number of frames added.
+        /// </summary>
+        public int CommitChunk(long _limit)
+        {
+            lock (m_Locker)
+            {
+                long limit = m_Frames.Count > 0 ? Math.Min(_limit, m_Frames[0].Timestamp) : _limit;
+                for (int i = m_Pending.Count - 1; i >= 0; i--)
+                {
+                    if (m_Pending[i].Timestamp < limit)
+                        continue;
+
+                    DisposeFrame(m_Pending[i]);
+                    m_Pending.RemoveAt(i);
+                }
+
+                int count = m_Pending.Count;
+                if (count == 0)
+                    return 0;
+
+                m_Frames.InsertRange(0, m_Pending);
+                m_ChunkSizes.Insert(0, count);
+                m_Pending.Clear();
+
+                if (m_CurrentIndex >= 0)
+                    m_CurrentIndex += count;
+
+                UpdateSegment();
+                return count;
+            }
+        }
+
+        public bool Contains(long _timestamp)
+        {
+            lock (m_Locker)
+                return m_Segment.Contains(_timestamp);
+        }
+
+        /// <summary>
+        /// Move the playhead to the first frame at or after the timestamp.
+        /// </summary>
+        public bool MoveTo(long _timestamp)
+        {
+            lock (m_Locker)
+            {
+                if (!m_Segment.Contains(_timestamp))
+                    return false;
+
+                for (int i = 0; i < m_Frames.Count; i++)
+                {
+                    if (m_Frames[i].Timestamp >= _timestamp)
+                    {
+                        m_CurrentIndex = i;
+                        break;
+                    }
+                }
+
+                m_Current = m_Frames[m_CurrentIndex];
+                ForgetLaterChunks();
+
+                // Wake up the decoding thread in case we entered the prefetched chunk.
+                Monitor.Pulse(m_Locker);
+            }
+
+            return true;
+        }
+
+        /// <summary>
+        /// Blocks until the buffer needs an earlier chunk, and returns the timestamp of the earliest buffered frame.
+        /// Returns -1 if the buffer is empty or on cancellation.
+        /// </summary>
+        public long WaitForPrefetch(ThreadCanceler _canceler)
+        {
+            lock (m_Locker)
+            {
+                // Nothing to prefetch until the playhead has been positioned in the first chunk.
+                while (!_canceler.CancellationPending && m_Frames.Count > 0 && (m_CurrentIndex < 0 || GetChunkIndex(m_CurrentIndex) > 0))
+                    Monitor.Wait(m_Locker);
+
+                if (_canceler.CancellationPending || m_Frames.Count == 0)
+                    return -1;
+
+                return m_Frames[0].Timestamp;
+            }
+        }
+
+        /// <summary>
+        /// Wake up the decoding thread so it can check for cancellation.
+        /// </summary>
+        public void Unblock()
+        {
+            lock (m_Locker)
+                Monitor.Pulse(m_Locker);
+        }
+
+        /// <summary>
+        /// Empty the buffer, handing the current frame over to the caller instead of disposing it.
+        /// </summary>
+        public VideoFrame Detach()
+        {
+            lock (m_Locker)
+            {
+                VideoFrame current = m_Current;
+                if (current != null)
+                    m_Frames.RemoveAt(m_CurrentIndex);
+
+                Clear();
+                return current;
+            }
+        }
+
+        public void Clear()
+        {
+            lock (m_Locker)
+            {
+                m_Current = null;
+
+                foreach (VideoFrame vf in m_Frames)
+                    DisposeFrame(vf);
+
+                m_Frames.Clear();
+                m_ChunkSizes.Clear();
+                ClearPending();
+                m_CurrentIndex = -1;
+                m_Segment = VideoSection.Empty;
+
+                Monitor.Pulse(m_Locker);
+            }
+        }
+        #endregion
+
+        #region Private methods
+        private int GetChunkIndex(int _frameIndex)
+        {
+            // Index of the chunk containing the frame. Always inside a lock.
+            int first = 0;
+            for (int i = 0; i < m_ChunkSizes.Count; i++)
+            {
+                if (_frameIndex < first + m_ChunkSizes[i])
+                    return i;
+
+                first += m_ChunkSizes[i];
+            }
+
+            return m_ChunkSizes.Count - 1;
+        }
+        private void ForgetLaterChunks()
+        {
+            // Only keep one chunk after the current one, so we can still step forward a little bit.
+            // Always inside a lock.
+            int keep = GetChunkIndex(m_CurrentIndex) + 2;
+            while (m_ChunkSizes.Count > keep)
+            {
+                int last = m_ChunkSizes.Count - 1;
+                int count = m_ChunkSizes[last];
+                for (int i = m_Frames.Count - count; i < m_Frames.Count; i++)
+                    DisposeFrame(m_Frames[i]);
+
+                m_Frames.RemoveRange(m_Frames.Count - count, count);
+                m_ChunkSizes.RemoveAt(last);
+            }
+
+            UpdateSegment();
+        }
+        private void ClearPending()
+        {
+            foreach (VideoFrame vf in m_Pending)
+                DisposeFrame(vf);
+
+            m_Pending.Clear();
+        }
+        private void UpdateSegment()
+        {
+            if (m_Frames.Count < 1)
+                m_Segment = VideoSection.Empty;
+            else
+                m_Segment = new VideoSection(m_Frames[0].Timestamp, m_Frames[m_Frames.Count - 1].Timestamp);
+        }
+        private void DisposeFrame(VideoFrame _frame)
+        {
+            if (m_DisposeBitmap != null)
+                m_DisposeBitmap(_frame);
+            else
+                _frame.Image.Dispose();
+        }
+        #endregion
+    }
+}
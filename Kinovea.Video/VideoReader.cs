@@ -67,6 +67,9 @@ namespace Kinovea.Video
             get {return 0; }
         }
         public VideoOptions Options { get; set; }
+
+        // If set, readers decoding several frames during summary extraction should stop as soon as cancellation is requested.
+        public ThreadCanceler SummaryCanceler { get; set; }
         
         public string FilePath {
             get { return Info.FilePath; }
@@ -92,6 +95,9 @@ namespace Kinovea.Video
         public bool CanPreBuffer {
             get { return (Flags & VideoCapabilities.CanPreBuffer) != 0; }
         }
+        public bool CanReverseBuffer {
+            get { return (Flags & VideoCapabilities.CanReverseBuffer) != 0; }
+        }
         public bool CanCache {
             get { return (Flags & VideoCapabilities.CanCache) != 0; }
         }
@@ -202,6 +208,8 @@ namespace Kinovea.Video
                     return CanPreBuffer;
                 case VideoDecodingMode.Caching:
                     return CanCache;
+                case VideoDecodingMode.ReverseBuffering:
+                    return CanReverseBuffer;
                 default:
                     return false;
             }
@@ -272,6 +280,24 @@ namespace Kinovea.Video
         {
             // Does nothing by default. Override to implement.
         }
+
+        /// <summary>
+        /// Whether the section can be exported to the passed container by copying the compressed stream as is.
+        /// This is only possible when the decoded images would not be altered by the current options, 
+        /// and when the section starts on a keyframe so the copy does not include frames before it.
+        /// </summary>
+        public virtual bool CanRemux(VideoSection section, string formatString)
+        {
+            return false;
+        }
+        /// <summary>
+        /// Export the working zone by copying the compressed stream into a new container, without decoding.
+        /// Only valid when CanRemux returned true for the section.
+        /// </summary>
+        public virtual SaveResult Remux(SavingSettings settings, string formatString, BackgroundWorker worker)
+        {
+            throw new CapabilityNotSupportedException();
+        }
         
         /// <summary>
         /// Provide a lazy enumerator on each frame of the Working Zone.
@@ -63,6 +63,8 @@ namespace Kinovea.Root
       this.lblImageFormat = new System.Windows.Forms.Label();
       this.chkLockSpeeds = new System.Windows.Forms.CheckBox();
       this.tabMemory = new System.Windows.Forms.TabPage();
+      this.lblEncodingProfile = new System.Windows.Forms.Label();
+      this.cmbEncodingProfile = new System.Windows.Forms.ComboBox();
       ((System.ComponentModel.ISupportInitialize)(this.trkMemoryBuffer)).BeginInit();
       this.tabSubPages.SuspendLayout();
       this.tabGeneral.SuspendLayout();
@@ -116,6 +118,8 @@ namespace Kinovea.Root
       // 
       // tabGeneral
       // 
+      this.tabGeneral.Controls.Add(this.cmbEncodingProfile);
+      this.tabGeneral.Controls.Add(this.lblEncodingProfile);
       this.tabGeneral.Controls.Add(this.lblPlaybackKVA);
       this.tabGeneral.Controls.Add(this.tbPlaybackKVA);
       this.tabGeneral.Controls.Add(this.btnPlaybackKVA);
@@ -229,6 +233,24 @@ namespace Kinovea.Root
       this.chkLockSpeeds.UseVisualStyleBackColor = true;
       this.chkLockSpeeds.CheckedChanged += new System.EventHandler(this.ChkLockSpeedsCheckedChanged);
       // 
+      // lblEncodingProfile
+      // 
+      this.lblEncodingProfile.AutoSize = true;
+      this.lblEncodingProfile.Location = new System.Drawing.Point(20, 261);
+      this.lblEncodingProfile.Name = "lblEncodingProfile";
+      this.lblEncodingProfile.Size = new System.Drawing.Size(122, 13);
+      this.lblEncodingProfile.TabIndex = 64;
+      this.lblEncodingProfile.Text = "Video export encoding :";
+      // 
+      // cmbEncodingProfile
+      // 
+      this.cmbEncodingProfile.DropDownStyle = System.Windows.Forms.ComboBoxStyle.DropDownList;
+      this.cmbEncodingProfile.Location = new System.Drawing.Point(263, 258);
+      this.cmbEncodingProfile.Name = "cmbEncodingProfile";
+      this.cmbEncodingProfile.Size = new System.Drawing.Size(201, 21);
+      this.cmbEncodingProfile.TabIndex = 65;
+      this.cmbEncodingProfile.SelectedIndexChanged += new System.EventHandler(this.cmbEncodingProfile_SelectedIndexChanged);
+      // 
       // tabMemory
       // 
       this.tabMemory.Controls.Add(this.trkMemoryBuffer);
@@ -273,5 +295,7 @@ namespace Kinovea.Root
         private System.Windows.Forms.Label lblPlaybackKVA;
         private System.Windows.Forms.TextBox tbPlaybackKVA;
         private System.Windows.Forms.Button btnPlaybackKVA;
+        private System.Windows.Forms.Label lblEncodingProfile;
+        private System.Windows.Forms.ComboBox cmbEncodingProfile;
     }
 }
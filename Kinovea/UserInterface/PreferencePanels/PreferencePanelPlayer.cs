@@ -70,6 +70,7 @@ namespace Kinovea.Root
         private bool syncByMotion;
         private int memoryBuffer;
         private string playbackKVA;
+        private VideoEncodingProfile videoEncodingProfile;
         #endregion
         
         #region Construction & Initialization
@@ -108,6 +109,7 @@ namespace Kinovea.Root
             syncByMotion = PreferencesManager.PlayerPreferences.SyncByMotion;
             memoryBuffer = PreferencesManager.PlayerPreferences.WorkingZoneMemory;
             playbackKVA = PreferencesManager.PlayerPreferences.PlaybackKVA;
+            videoEncodingProfile = PreferencesManager.PlayerPreferences.VideoEncodingProfile;
         }
         private void InitPage()
         {
@@ -142,6 +144,16 @@ namespace Kinovea.Root
             // Select current image format.
             int selected = (int)imageAspectRatio;
             cmbImageFormats.SelectedIndex = selected < cmbImageFormats.Items.Count ? selected : 0;
+
+            // Combo encoding profiles (MUST be filled in the order of the enum)
+            lblEncodingProfile.Text = "Video export encoding :";
+            cmbEncodingProfile.Items.Add("MPEG-4, all keyframes");
+            cmbEncodingProfile.Items.Add("MJPEG, all keyframes");
+            cmbEncodingProfile.Items.Add("H.264, all keyframes");
+            cmbEncodingProfile.Items.Add("H.264, short GOP");
+            
+            int selectedProfile = (int)videoEncodingProfile;
+            cmbEncodingProfile.SelectedIndex = selectedProfile < cmbEncodingProfile.Items.Count ? selectedProfile : 0;
         }
 
         private void InitPageMemory()
@@ -183,6 +195,10 @@ namespace Kinovea.Root
         {
             imageAspectRatio = (ImageAspectRatio)cmbImageFormats.SelectedIndex;
         }
+        private void cmbEncodingProfile_SelectedIndexChanged(object sender, EventArgs e)
+        {
+            videoEncodingProfile = (VideoEncodingProfile)cmbEncodingProfile.SelectedIndex;
+        }
         private void tbPlaybackKVA_TextChanged(object sender, EventArgs e)
         {
             playbackKVA = tbPlaybackKVA.Text;
@@ -235,6 +251,7 @@ namespace Kinovea.Root
             PreferencesManager.PlayerPreferences.InteractiveFrameTracker = interactiveFrameTracker;
             PreferencesManager.PlayerPreferences.AspectRatio = imageAspectRatio;
             PreferencesManager.PlayerPreferences.PlaybackKVA = playbackKVA;
+            PreferencesManager.PlayerPreferences.VideoEncodingProfile = videoEncodingProfile;
             PreferencesManager.PlayerPreferences.WorkingZoneMemory = memoryBuffer;
         }
     }